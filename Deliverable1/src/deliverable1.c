@@ -4,9 +4,16 @@
 #include "libraries/mmio.h"
 #include "libraries/mmio.c"
 #include "libraries/bubblesort.c"
+#include "libraries/generator.c"
+#include "libraries/matrix_families.c"
+#include "libraries/fast_parse.c"
+#include "libraries/csb.c"
+#include "libraries/SpMV.c"
+#include "libraries/complex_spmv.c"
 #include <omp.h>
 #include <string.h>
 #include <stdbool.h>
+#include <math.h>
 
 #define REPETITIONS 10
 
@@ -59,46 +66,46 @@ void compute_avg_speedup(double *speedup_values, int size, double *avg_speedup)
     *avg_speedup = total / (double)(size-1);
 }
 
-void seq_molt(int *row_ptr, double *values, int *vec, double *result, int M, int nz) {
+void seq_molt(nz_t *row_ptr, double *values, int *vec, double *result, int M, nz_t nz) {
     // Go through each row (row_ptr has M+1 elements)
     for (int i = 0; i < M; i++) {
         // For each row, go through its non-zero elements
-        for (int j = row_ptr[i]; j < row_ptr[i+1]; j++) {
+        for (nz_t j = row_ptr[i]; j < row_ptr[i+1]; j++) {
             //printf("Row %d, accessing value index %d\n", i, j);
             result[i] += values[j] * vec[i];
         }
     }
 }
 
-void csr_par_molt(int *row_ptr, double *values, int *vec, double *result, int M, int nz) {
+void csr_par_molt(nz_t *row_ptr, double *values, int *vec, double *result, int M, nz_t nz) {
     // This time we parallelize the inner loop since is the most time consuming
     for (int i = 0; i < M; i++) {
         #pragma omp parallel for reduction(+:result[i])
-        for (int j = row_ptr[i]; j < row_ptr[i+1]; j++) {
+        for (nz_t j = row_ptr[i]; j < row_ptr[i+1]; j++) {
             //printf("Row %d, accessing value index %d\n", i, j);
             result[i] += values[j] * vec[i];
         }
     }
 }
 
-void csr2_par_molt(int *s_row, int num_sr, int *row_ptr, double *values, int *vec, double *result) {
+void csr2_par_molt(int *s_row, int num_sr, nz_t *row_ptr, double *values, int *vec, double *result) {
     #pragma omp parallel for
     for(int i = 0; i < num_sr; i++) {
         int sr_start = s_row[i];
         int sr_end = s_row[i+1];
 
         for (int j = sr_start; j < sr_end; j++) {
-            int row_start = row_ptr[j];
-            int row_end = row_ptr[j+1];
+            nz_t row_start = row_ptr[j];
+            nz_t row_end = row_ptr[j+1];
 
-            for(int k = row_start; k < row_end; k++) {
+            for(nz_t k = row_start; k < row_end; k++) {
                 result[j] += values[k] * vec[j];
             }
         }
     }
 }
 
-void csr3_par_molt(int *ss_row, int num_ssr, int *s_row, int *row_ptr, double *values, int *vec, double *result) {
+void csr3_par_molt(int *ss_row, int num_ssr, int *s_row, nz_t *row_ptr, double *values, int *vec, double *result) {
     #pragma omp parallel for
     for(int i = 0; i < num_ssr; i++) {
         int ssr_start = ss_row[i];
@@ -109,10 +116,10 @@ void csr3_par_molt(int *ss_row, int num_ssr, int *s_row, int *row_ptr, double *v
             int sr_end = s_row[j+1];
 
             for (int k = sr_start; k < sr_end; k++) {
-                int row_start = row_ptr[k];
-                int row_end = row_ptr[k+1];
+                nz_t row_start = row_ptr[k];
+                nz_t row_end = row_ptr[k+1];
 
-                for(int l = row_start; l < row_end; l++) {
+                for(nz_t l = row_start; l < row_end; l++) {
                     result[k] += values[l] * vec[k];
                 }
             }
@@ -120,25 +127,546 @@ void csr3_par_molt(int *ss_row, int num_ssr, int *s_row, int *row_ptr, double *v
     }
 }
 
+/*
+ * Complex SpMV y = A x, rows split among the threads. The same complex CSR matrix is stored in two layouts:
+ *  - interleaved: (re, im) of element j at [2j] and [2j+1] of values, vector and result
+ *  - split: real and imaginary parts in separate arrays
+ * and in float values (vector and accumulation in double), so the four can be timed against each other.
+ * Each thread runs the kernel of libraries/complex_spmv.c on its own block of rows.
+ */
+void thread_rows(int M, int *start, int *end) {
+    // Contiguous block of rows of the calling thread, as schedule(static) gives
+    int threads = omp_get_num_threads();
+    int t = omp_get_thread_num();
+    *start = (int) ((long) M * t / threads);
+    *end = (int) ((long) M * (t + 1) / threads);
+}
+
+void complex_par_molt(int M, nz_t *row_ptr, int *col_idx, double *values, double *vec, double *result) {
+    #pragma omp parallel
+    {
+        int start, end;
+        thread_rows(M, &start, &end);
+        SpMV_csr_complex(end - start, row_ptr + start, col_idx, values, vec, result + 2 * (size_t) start);
+    }
+}
+
+void complex_split_par_molt(int M, nz_t *row_ptr, int *col_idx, double *values_re, double *values_im,
+                            double *vec_re, double *vec_im, double *result_re, double *result_im) {
+    #pragma omp parallel
+    {
+        int start, end;
+        thread_rows(M, &start, &end);
+        SpMV_csr_complex_split(end - start, row_ptr + start, col_idx, values_re, values_im, vec_re, vec_im, result_re + start, result_im + start);
+    }
+}
+
+void complex_float_par_molt(int M, nz_t *row_ptr, int *col_idx, float *values, double *vec, double *result) {
+    #pragma omp parallel
+    {
+        int start, end;
+        thread_rows(M, &start, &end);
+        SpMV_csr_complex_float(end - start, row_ptr + start, col_idx, values, vec, result + 2 * (size_t) start);
+    }
+}
+
+void complex_split_float_par_molt(int M, nz_t *row_ptr, int *col_idx, float *values_re, float *values_im,
+                                  double *vec_re, double *vec_im, double *result_re, double *result_im) {
+    #pragma omp parallel
+    {
+        int start, end;
+        thread_rows(M, &start, &end);
+        SpMV_csr_complex_split_float(end - start, row_ptr + start, col_idx, values_re, values_im, vec_re, vec_im, result_re + start, result_im + start);
+    }
+}
+
+#define COMPLEX_LAYOUTS 4
+static const char *complex_layout_names[COMPLEX_LAYOUTS] = {"Interleaved", "Split", "Interleaved float", "Split float"};
+
+void complex_benchmark(int M, int N, nz_t nz, int *I, int *J, double *vals_re, double *vals_im, char *results_filename) {
+    nz_t i;
+
+    // COO to CSR: the entries are counted per row and placed directly, in file order, so no sort is needed
+    nz_t *row_ptr = (nz_t *) calloc(M+1, sizeof(nz_t));
+    int *col_idx = (int *) malloc((nz+1) * sizeof(int));
+    nz_t *next = (nz_t *) malloc((M+1) * sizeof(nz_t));
+    double *values = (double *) malloc(2 * ((size_t) nz+1) * sizeof(double)); // Interleaved
+    double *values_re = (double *) malloc((nz+1) * sizeof(double)); // Split, in CSR order
+    double *values_im = (double *) malloc((nz+1) * sizeof(double));
+    float *values_f = (float *) malloc(2 * ((size_t) nz+1) * sizeof(float));
+    float *values_re_f = (float *) malloc((nz+1) * sizeof(float));
+    float *values_im_f = (float *) malloc((nz+1) * sizeof(float));
+    if (!row_ptr || !col_idx || !next || !values || !values_re || !values_im || !values_f || !values_re_f || !values_im_f) {
+        printf("Failed to allocate memory for the complex matrix\n");
+        exit(1);
+    }
+    for (i = 0; i < nz; i++) {
+        row_ptr[I[i]+1]++;
+    }
+    for (i = 0; i < M; i++) {
+        row_ptr[i+1] += row_ptr[i];
+    }
+    memcpy(next, row_ptr, (M+1) * sizeof(nz_t));
+    for (i = 0; i < nz; i++) {
+        nz_t k = next[I[i]]++;
+        col_idx[k] = J[i];
+        values[2 * (size_t) k] = vals_re[i];
+        values[2 * (size_t) k + 1] = vals_im[i];
+    }
+    for (i = 0; i < nz; i++) {
+        values_re[i] = values[2 * (size_t) i];
+        values_im[i] = values[2 * (size_t) i + 1];
+        values_re_f[i] = (float) values_re[i];
+        values_im_f[i] = (float) values_im[i];
+        values_f[2 * (size_t) i] = values_re_f[i];
+        values_f[2 * (size_t) i + 1] = values_im_f[i];
+    }
+    free(next);
+
+    double *vec = (double *) malloc(2 * ((size_t) N+1) * sizeof(double));
+    double *vec_re = (double *) malloc((N+1) * sizeof(double));
+    double *vec_im = (double *) malloc((N+1) * sizeof(double));
+    double *seq_result = (double *) malloc(2 * ((size_t) M+1) * sizeof(double));
+    double *par_result = (double *) malloc(2 * ((size_t) M+1) * sizeof(double));
+    double *result_re = (double *) malloc((M+1) * sizeof(double));
+    double *result_im = (double *) malloc((M+1) * sizeof(double));
+    double *speedup_values[COMPLEX_LAYOUTS];
+    for (int layout = 0; layout < COMPLEX_LAYOUTS; layout++) {
+        speedup_values[layout] = (double *) malloc(REPETITIONS * sizeof(double));
+    }
+
+    double start, end;
+    for (int r = 0; r < REPETITIONS; r++) {
+        // Random complex vector, also split
+        for (i = 0; i < N; i++) {
+            vec_re[i] = (rand() % 9) + 1;
+            vec_im[i] = (rand() % 9) + 1;
+            vec[2 * (size_t) i] = vec_re[i];
+            vec[2 * (size_t) i + 1] = vec_im[i];
+        }
+
+        start = omp_get_wtime() * 1000.0;
+        SpMV_csr_complex(M, row_ptr, col_idx, values, vec, seq_result);
+        end = omp_get_wtime() * 1000.0;
+        double seq_cpu_time_used = end - start;
+
+        printf("=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=\n");
+        printf("Sequential complex execution time for execution %d: %f milliseconds\n", r+1, seq_cpu_time_used);
+
+        for (int layout = 0; layout < COMPLEX_LAYOUTS; layout++) {
+            start = omp_get_wtime() * 1000.0;
+            if (layout == 0) {
+                complex_par_molt(M, row_ptr, col_idx, values, vec, par_result);
+            } else if (layout == 1) {
+                complex_split_par_molt(M, row_ptr, col_idx, values_re, values_im, vec_re, vec_im, result_re, result_im);
+            } else if (layout == 2) {
+                complex_float_par_molt(M, row_ptr, col_idx, values_f, vec, par_result);
+            } else {
+                complex_split_float_par_molt(M, row_ptr, col_idx, values_re_f, values_im_f, vec_re, vec_im, result_re, result_im);
+            }
+            end = omp_get_wtime() * 1000.0;
+            double cpu_time_used = end - start;
+
+            if (layout == 1 || layout == 3) { // Back to interleaved for the check, outside the timing
+                split_to_complex(M, result_re, result_im, par_result);
+            }
+
+            speedup_values[layout][r] = seq_cpu_time_used / cpu_time_used * 100.0;
+            printf("%s parallel execution time for execution %d: %f milliseconds - Speedup: %.2f%%\n",
+                   complex_layout_names[layout], r+1, cpu_time_used, speedup_values[layout][r]);
+
+            // Float values cannot match the double result, their error is reported instead
+            double max_abs, relative;
+            compute_error(seq_result, par_result, 2 * M, &max_abs, &relative);
+            if (layout >= 2) {
+                printf("Relative error of %s against double: %e\n", complex_layout_names[layout], relative);
+            } else if (max_abs > 0.00001) {
+                printf("Results are NOT correct for %s parallelization.\n", complex_layout_names[layout]);
+            } else {
+                printf("Results are correct for %s parallelization.\n", complex_layout_names[layout]);
+            }
+        }
+        printf("=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=\n");
+        printf("\n");
+        fflush(stdout);
+    }
+
+    // Write the average speedups, one column per layout
+    FILE *fptr = fopen(results_filename, "w");
+    if (!fptr) {
+        printf("Could not open file: %s\n", results_filename);
+        exit(1);
+    }
+    for (int layout = 0; layout < COMPLEX_LAYOUTS; layout++) {
+        double avg_speedup = 0.0;
+        compute_avg_speedup(speedup_values[layout], REPETITIONS, &avg_speedup);
+        printf("%s average speedup: %.2f%%\n", complex_layout_names[layout], avg_speedup);
+        fprintf(fptr, (layout < COMPLEX_LAYOUTS - 1) ? "%4.6f," : "%4.6f\n", avg_speedup);
+        free(speedup_values[layout]);
+    }
+    fclose(fptr);
+
+    free(row_ptr);
+    free(col_idx);
+    free(values);
+    free(values_re);
+    free(values_im);
+    free(values_f);
+    free(values_re_f);
+    free(values_im_f);
+    free(vec);
+    free(vec_re);
+    free(vec_im);
+    free(seq_result);
+    free(par_result);
+    free(result_re);
+    free(result_im);
+}
+
+/*
+ * Transposed SpMV y = A^T x on the CSR of A, without building A^T: row i scatters values[j] * x[i]
+ * into y[col_idx[j]]. Different rows can scatter into the same y entry, so each thread accumulates
+ * in its own copy of y (buffers holds threads * N doubles) and the copies are summed by column.
+ * It is timed against the row-parallel product on an explicitly transposed CSR.
+ */
+void transpose_private_molt(int M, int N, nz_t *row_ptr, int *col_idx, double *values, double *vec, double *result, double *buffers) {
+    #pragma omp parallel
+    {
+        int threads = omp_get_num_threads();
+        double *private_result = buffers + (size_t) omp_get_thread_num() * N;
+        for (int i = 0; i < N; i++) {
+            private_result[i] = 0.0;
+        }
+
+        #pragma omp for schedule(static)
+        for (int i = 0; i < M; i++) {
+            for (nz_t j = row_ptr[i]; j < row_ptr[i+1]; j++) {
+                private_result[col_idx[j]] += values[j] * vec[i];
+            }
+        }
+        // Implicit barrier: every copy is complete before the sum
+
+        #pragma omp for schedule(static)
+        for (int c = 0; c < N; c++) {
+            double sum = 0.0;
+            for (int t = 0; t < threads; t++) {
+                sum += buffers[(size_t) t * N + c];
+            }
+            result[c] = sum;
+        }
+    }
+}
+
+void csr_rows_par_molt(int M, nz_t *row_ptr, int *col_idx, double *values, double *vec, double *result) {
+    // Row-parallel y = A x on any CSR with a double vector: A^T for the explicit transpose, A for the CSB baseline
+    #pragma omp parallel for
+    for (int i = 0; i < M; i++) {
+        double sum = 0.0;
+        for (nz_t j = row_ptr[i]; j < row_ptr[i+1]; j++) {
+            sum += values[j] * vec[col_idx[j]];
+        }
+        result[i] = sum;
+    }
+}
+
+void transpose_benchmark(int M, int N, nz_t *row_ptr, int *col_idx, double *values, char *results_filename) {
+    double *vec = (double *) malloc((M+1) * sizeof(double));
+    double *seq_result = (double *) malloc((N+1) * sizeof(double));
+    double *private_result = (double *) malloc((N+1) * sizeof(double));
+    double *explicit_result = (double *) malloc((N+1) * sizeof(double));
+    double *buffers = (double *) malloc((size_t) omp_get_max_threads() * (N+1) * sizeof(double));
+    nz_t *t_row_ptr;
+    int *t_col_idx;
+    double *t_values;
+    double *private_speedup_values = (double *) malloc(REPETITIONS * sizeof(double));
+    double *explicit_speedup_values = (double *) malloc(REPETITIONS * sizeof(double));
+    double *built_speedup_values = (double *) malloc(REPETITIONS * sizeof(double));
+    if (!vec || !seq_result || !private_result || !explicit_result || !buffers
+        || !private_speedup_values || !explicit_speedup_values || !built_speedup_values) {
+        printf("Failed to allocate memory for the transposed product\n");
+        exit(1);
+    }
+
+    double start, end;
+    for (int r = 0; r < REPETITIONS; r++) {
+        for (int i = 0; i < M; i++) {
+            vec[i] = (rand() % 9) + 1;
+        }
+
+        start = omp_get_wtime() * 1000.0;
+        SpMV_csr_transpose(M, N, row_ptr, col_idx, values, vec, seq_result);
+        end = omp_get_wtime() * 1000.0;
+        double seq_cpu_time_used = end - start;
+
+        start = omp_get_wtime() * 1000.0;
+        transpose_private_molt(M, N, row_ptr, col_idx, values, vec, private_result, buffers);
+        end = omp_get_wtime() * 1000.0;
+        double private_cpu_time_used = end - start;
+
+        start = omp_get_wtime() * 1000.0; // The build includes the allocation of A^T
+        if (!csr_transpose(M, N, row_ptr, col_idx, values, &t_row_ptr, &t_col_idx, &t_values)) {
+            exit(1);
+        }
+        end = omp_get_wtime() * 1000.0;
+        double build_cpu_time_used = end - start;
+
+        start = omp_get_wtime() * 1000.0;
+        csr_rows_par_molt(N, t_row_ptr, t_col_idx, t_values, vec, explicit_result);
+        end = omp_get_wtime() * 1000.0;
+        double explicit_cpu_time_used = end - start;
+
+        private_speedup_values[r] = seq_cpu_time_used / private_cpu_time_used * 100.0;
+        explicit_speedup_values[r] = seq_cpu_time_used / explicit_cpu_time_used * 100.0;
+        built_speedup_values[r] = seq_cpu_time_used / (build_cpu_time_used + explicit_cpu_time_used) * 100.0;
+
+        printf("=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=\n");
+        printf("Sequential transposed execution time for execution %d: %f milliseconds\n", r+1, seq_cpu_time_used);
+        printf("Private buffers transposed execution time for execution %d: %f milliseconds - Speedup: %.2f%%\n", r+1, private_cpu_time_used, private_speedup_values[r]);
+        printf("Explicit transpose execution time for execution %d: %f milliseconds - Speedup: %.2f%% (%.2f%% with the %f milliseconds to build it)\n",
+               r+1, explicit_cpu_time_used, explicit_speedup_values[r], built_speedup_values[r], build_cpu_time_used);
+
+        bool private_correct = check_results(seq_result, private_result, N);
+        bool explicit_correct = check_results(seq_result, explicit_result, N);
+        free(t_row_ptr);
+        free(t_col_idx);
+        free(t_values);
+        printf("Results are %s for private buffers transposed parallelization.\n", private_correct ? "correct" : "NOT correct");
+        printf("Results are %s for explicit transpose parallelization.\n", explicit_correct ? "correct" : "NOT correct");
+        printf("=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=\n");
+        printf("\n");
+        fflush(stdout);
+    }
+
+    // Average speedups: private buffers, explicit transpose, explicit transpose including its construction
+    double private_avg_speedup = 0.0, explicit_avg_speedup = 0.0, built_avg_speedup = 0.0;
+    compute_avg_speedup(private_speedup_values, REPETITIONS, &private_avg_speedup);
+    compute_avg_speedup(explicit_speedup_values, REPETITIONS, &explicit_avg_speedup);
+    compute_avg_speedup(built_speedup_values, REPETITIONS, &built_avg_speedup);
+    printf("Transposed average speedup: private buffers %.2f%%, explicit transpose %.2f%% (%.2f%% with its construction)\n",
+           private_avg_speedup, explicit_avg_speedup, built_avg_speedup);
+    FILE *fptr = fopen(results_filename, "w");
+    if (!fptr) {
+        printf("Could not open file: %s\n", results_filename);
+        exit(1);
+    }
+    fprintf(fptr, "%4.6f,%4.6f,%4.6f\n", private_avg_speedup, explicit_avg_speedup, built_avg_speedup);
+    fclose(fptr);
+
+    free(vec);
+    free(seq_result);
+    free(private_result);
+    free(explicit_result);
+    free(buffers);
+    free(private_speedup_values);
+    free(explicit_speedup_values);
+    free(built_speedup_values);
+}
+
+/*
+ * Compressed Sparse Blocks (libraries/csb.c): beta x beta blocks with 16 bit in-block indices.
+ * A block row of A x and a block column of A^T x write disjoint parts of y, so both products
+ * are parallel over blocks without private copies of y, and each thread reads only beta entries
+ * of x at a time. They are timed against the row-parallel CSR product and the private buffers
+ * transposed product.
+ */
+void csb_par_molt(int M, int N, int beta, nz_t *blk_ptr, uint16_t *blk_row, uint16_t *blk_col, double *blk_vals, double *vec, double *result) {
+    int block_rows = (M + beta - 1) / beta;
+    // Dynamic: the non-zeros per block row can differ a lot
+    #pragma omp parallel for schedule(dynamic)
+    for (int bi = 0; bi < block_rows; bi++) {
+        SpMV_csb_block_row(bi, M, N, beta, blk_ptr, blk_row, blk_col, blk_vals, vec, result);
+    }
+}
+
+void csb_transpose_par_molt(int M, int N, int beta, nz_t *blk_ptr, uint16_t *blk_row, uint16_t *blk_col, double *blk_vals, double *vec, double *result) {
+    int block_cols = (N + beta - 1) / beta;
+    #pragma omp parallel for schedule(dynamic)
+    for (int bj = 0; bj < block_cols; bj++) {
+        SpMV_csb_block_column(bj, M, N, beta, blk_ptr, blk_row, blk_col, blk_vals, vec, result);
+    }
+}
+
+void csb_benchmark(int M, int N, nz_t *row_ptr, int *col_idx, double *values, char *results_filename) {
+    nz_t nz = row_ptr[M]; // row_ptr is the nz_t CSR of main, passed to csr_to_csb as it is
+    int beta = csb_default_beta(M, N);
+    nz_t *blk_ptr;
+    uint16_t *blk_row, *blk_col;
+    double *blk_vals;
+    double start = omp_get_wtime() * 1000.0;
+    if (!csr_to_csb(M, N, row_ptr, col_idx, values, beta, &blk_ptr, &blk_row, &blk_col, &blk_vals)) {
+        exit(1);
+    }
+    double build_cpu_time_used = omp_get_wtime() * 1000.0 - start;
+    long blocks = (long) ((M + beta - 1) / beta) * ((N + beta - 1) / beta);
+    printf("CSB with beta %d: %ld blocks, built in %f milliseconds, %ld index bytes instead of %ld for CSR\n", beta, blocks, build_cpu_time_used,
+           (blocks + 1) * (long) sizeof(nz_t) + (long) nz * 2 * sizeof(uint16_t), (long) (M + 1) * sizeof(nz_t) + (long) nz * sizeof(int));
+
+    double *vec = (double *) malloc(((size_t) (M > N ? M : N) + 1) * sizeof(double));
+    double *seq_result = (double *) malloc(((size_t) (M > N ? M : N) + 1) * sizeof(double));
+    double *par_result = (double *) malloc(((size_t) (M > N ? M : N) + 1) * sizeof(double));
+    double *csb_result = (double *) malloc(((size_t) (M > N ? M : N) + 1) * sizeof(double));
+    double *buffers = (double *) malloc((size_t) omp_get_max_threads() * (N+1) * sizeof(double));
+    double *csr_speedup_values = (double *) malloc(REPETITIONS * sizeof(double));
+    double *csb_speedup_values = (double *) malloc(REPETITIONS * sizeof(double));
+    double *private_speedup_values = (double *) malloc(REPETITIONS * sizeof(double));
+    double *csb_transpose_speedup_values = (double *) malloc(REPETITIONS * sizeof(double));
+    if (!vec || !seq_result || !par_result || !csb_result || !buffers || !csr_speedup_values || !csb_speedup_values
+        || !private_speedup_values || !csb_transpose_speedup_values) {
+        printf("Failed to allocate memory for the CSB product\n");
+        exit(1);
+    }
+
+    double end;
+    for (int r = 0; r < REPETITIONS; r++) {
+        /* y = A x */
+        for (int i = 0; i < N; i++) {
+            vec[i] = (rand() % 9) + 1;
+        }
+        start = omp_get_wtime() * 1000.0;
+        SpMV_csr(M, row_ptr, col_idx, values, vec, seq_result);
+        end = omp_get_wtime() * 1000.0;
+        double seq_cpu_time_used = end - start;
+
+        start = omp_get_wtime() * 1000.0;
+        csr_rows_par_molt(M, row_ptr, col_idx, values, vec, par_result);
+        end = omp_get_wtime() * 1000.0;
+        double csr_cpu_time_used = end - start;
+
+        start = omp_get_wtime() * 1000.0;
+        csb_par_molt(M, N, beta, blk_ptr, blk_row, blk_col, blk_vals, vec, csb_result);
+        end = omp_get_wtime() * 1000.0;
+        double csb_cpu_time_used = end - start;
+
+        bool csr_correct = check_results(seq_result, par_result, M);
+        bool csb_correct = check_results(seq_result, csb_result, M);
+
+        /* y = A^T x */
+        for (int i = 0; i < M; i++) {
+            vec[i] = (rand() % 9) + 1;
+        }
+        start = omp_get_wtime() * 1000.0;
+        SpMV_csr_transpose(M, N, row_ptr, col_idx, values, vec, seq_result);
+        end = omp_get_wtime() * 1000.0;
+        double seq_transpose_cpu_time_used = end - start;
+
+        start = omp_get_wtime() * 1000.0;
+        transpose_private_molt(M, N, row_ptr, col_idx, values, vec, par_result, buffers);
+        end = omp_get_wtime() * 1000.0;
+        double private_cpu_time_used = end - start;
+
+        start = omp_get_wtime() * 1000.0;
+        csb_transpose_par_molt(M, N, beta, blk_ptr, blk_row, blk_col, blk_vals, vec, csb_result);
+        end = omp_get_wtime() * 1000.0;
+        double csb_transpose_cpu_time_used = end - start;
+
+        bool private_correct = check_results(seq_result, par_result, N);
+        bool csb_transpose_correct = check_results(seq_result, csb_result, N);
+
+        csr_speedup_values[r] = seq_cpu_time_used / csr_cpu_time_used * 100.0;
+        csb_speedup_values[r] = seq_cpu_time_used / csb_cpu_time_used * 100.0;
+        private_speedup_values[r] = seq_transpose_cpu_time_used / private_cpu_time_used * 100.0;
+        csb_transpose_speedup_values[r] = seq_transpose_cpu_time_used / csb_transpose_cpu_time_used * 100.0;
+
+        printf("=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=\n");
+        printf("Sequential CSR execution time for execution %d: %f milliseconds\n", r+1, seq_cpu_time_used);
+        printf("Parallel CSR execution time for execution %d: %f milliseconds - Speedup: %.2f%%\n", r+1, csr_cpu_time_used, csr_speedup_values[r]);
+        printf("Parallel CSB execution time for execution %d: %f milliseconds - Speedup: %.2f%%\n", r+1, csb_cpu_time_used, csb_speedup_values[r]);
+        printf("Sequential transposed execution time for execution %d: %f milliseconds\n", r+1, seq_transpose_cpu_time_used);
+        printf("Private buffers transposed execution time for execution %d: %f milliseconds - Speedup: %.2f%%\n", r+1, private_cpu_time_used, private_speedup_values[r]);
+        printf("Parallel CSB transposed execution time for execution %d: %f milliseconds - Speedup: %.2f%%\n", r+1, csb_transpose_cpu_time_used, csb_transpose_speedup_values[r]);
+        printf("Results are %s for CSR parallelization.\n", csr_correct ? "correct" : "NOT correct");
+        printf("Results are %s for CSB parallelization.\n", csb_correct ? "correct" : "NOT correct");
+        printf("Results are %s for private buffers transposed parallelization.\n", private_correct ? "correct" : "NOT correct");
+        printf("Results are %s for CSB transposed parallelization.\n", csb_transpose_correct ? "correct" : "NOT correct");
+        printf("=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=\n");
+        printf("\n");
+        fflush(stdout);
+    }
+
+    // Average speedups: CSR and CSB for A x, private buffers and CSB for A^T x
+    double csr_avg_speedup = 0.0, csb_avg_speedup = 0.0, private_avg_speedup = 0.0, csb_transpose_avg_speedup = 0.0;
+    compute_avg_speedup(csr_speedup_values, REPETITIONS, &csr_avg_speedup);
+    compute_avg_speedup(csb_speedup_values, REPETITIONS, &csb_avg_speedup);
+    compute_avg_speedup(private_speedup_values, REPETITIONS, &private_avg_speedup);
+    compute_avg_speedup(csb_transpose_speedup_values, REPETITIONS, &csb_transpose_avg_speedup);
+    printf("CSB average speedup: A x %.2f%% (CSR %.2f%%), A^T x %.2f%% (private buffers %.2f%%)\n",
+           csb_avg_speedup, csr_avg_speedup, csb_transpose_avg_speedup, private_avg_speedup);
+    FILE *fptr = fopen(results_filename, "w");
+    if (!fptr) {
+        printf("Could not open file: %s\n", results_filename);
+        exit(1);
+    }
+    fprintf(fptr, "%4.6f,%4.6f,%4.6f,%4.6f\n", csr_avg_speedup, csb_avg_speedup, private_avg_speedup, csb_transpose_avg_speedup);
+    fclose(fptr);
+
+    free(blk_ptr);
+    free(blk_row);
+    free(blk_col);
+    free(blk_vals);
+    free(vec);
+    free(seq_result);
+    free(par_result);
+    free(csb_result);
+    free(buffers);
+    free(csr_speedup_values);
+    free(csb_speedup_values);
+    free(private_speedup_values);
+    free(csb_transpose_speedup_values);
+}
+
+bool read_size_line(FILE *f, int *M, int *N, nz_t *nz) {
+    // Same as mm_read_mtx_crd_size, with the number of entries read in 64 bits:
+    // a file with more entries than nz_t can index is refused instead of overflowing
+    char line[MM_MAX_LINE_LENGTH + 1];
+    long long entries;
+    do {
+        if (fgets(line, sizeof(line), f) == NULL) {
+            return false;
+        }
+    } while (line[0] == '%');
+    if (sscanf(line, "%d %d %lld", M, N, &entries) != 3) {
+        return false;
+    }
+    if (entries > (long long) NZ_MAX) {
+        printf("The matrix has %lld entries, the code must be compiled with -DLONG_NZ\n", entries);
+        return false;
+    }
+    *nz = (nz_t) entries;
+    return true;
+}
+
 int main(int argc, char *argv[])
 {
-    int ret_code;
     MM_typecode matcode;
     FILE *f;
     int M; // Number of rows
     int N; // Number of columns
-    int nz; // Total number of non-zero entries
+    nz_t nz; // Total number of non-zero entries
     int i, *I, *J;
     double *vals;
+    double *vals_im = NULL; // Imaginary parts, for complex matrices
     int *ordered_rows;
     int *ordered_colums;
     double *ordered_val;
 
-    // Check the right amount of argument and open the file
-    if (argc != 3) {
-		fprintf(stderr, "Intended usage: %s [martix-market-filename] [number-of-threads]\n", argv[0]);
+    // Optional last arguments: also time the transposed product y = A^T x, and the CSB format
+    bool transpose = false, csb = false;
+    while (argc > 1 && (strcmp(argv[argc-1], "--transpose") == 0 || strcmp(argv[argc-1], "--csb") == 0)) {
+        if (strcmp(argv[argc-1], "--transpose") == 0) {
+            transpose = true;
+        } else {
+            csb = true;
+        }
+        argc--;
+    }
+
+    // Check the right amount of argument and open the file (or generate the matrix with --generate)
+    bool generated = (argc == 7 && strcmp(argv[1], "--generate") == 0);
+    if (argc != 3 && !generated) {
+		fprintf(stderr, "Intended usage: %s [martix-market-filename] [number-of-threads] [--transpose] [--csb]\n", argv[0]);
+		fprintf(stderr, "            or: %s --generate [uniform|rmat|laplace2d|laplace3d|blockdiag|denserows] [n-rows] [n-columns] [percent-nonzero] [number-of-threads] [--transpose] [--csb]\n", argv[0]);
 		exit(1);
-	} else { 
+	} else if (!generated) { 
         if ((f = fopen(argv[1], "r")) == NULL) {
             printf("Could not open file: %s\n", argv[1]);
             exit(1);
@@ -146,46 +674,125 @@ int main(int argc, char *argv[])
     }
 
     // Set number of threads
-    omp_set_num_threads(atoi(argv[2]));
+    omp_set_num_threads(atoi(argv[argc-1]));
 
     
-    if (mm_read_banner(f, &matcode) != 0) {
-        printf("Could not process Matrix Market banner.\n");
-        exit(1);
-    }
+    if (generated) {
+        // Structured synthetic matrix instead of a matrix market file
+        int family;
+        if (!parse_matrix_family(argv[2], &family)) {
+            fprintf(stderr, "Unknown matrix family: %s\n", argv[2]);
+            exit(1);
+        }
+        M = atoi(argv[3]);
+        N = atoi(argv[4]);
+        if (!generate_family_matrix(family, (uint64_t) time(NULL), M, N, atoi(argv[5]), &I, &J, &vals, &nz)) {
+            exit(1);
+        }
+    } else {
+        if (mm_read_banner(f, &matcode) != 0) {
+            printf("Could not process Matrix Market banner.\n");
+            exit(1);
+        }
 
 
-    /*  This is how one can screen matrix types if their application */
-    /*  only supports a subset of the Matrix Market data types.      */
-    if (mm_is_complex(matcode) && mm_is_matrix(matcode) && mm_is_sparse(matcode)){
-        printf("Sorry, this application does not support ");
-        printf("Market Market type: [%s]\n", mm_typecode_to_str(matcode));
-        exit(1);
-    }
+        /*  This is how one can screen matrix types if their application */
+        /*  only supports a subset of the Matrix Market data types.      */
+        if (!mm_is_sparse(matcode)) {
+            printf("Sorry, this application does not support ");
+            printf("Market Market type: [%s]\n", mm_typecode_to_str(matcode));
+            exit(1);
+        }
 
-    /* find out size of sparse matrix .... */
-    if ((ret_code = mm_read_mtx_crd_size(f, &M, &N, &nz)) !=0)
-        exit(1);
+        /* find out size of sparse matrix .... */
+        if (!read_size_line(f, &M, &N, &nz))
+            exit(1);
+        nz_t file_nz = nz; // Entries in the file, before adding the mirrored ones
 
 
-    /* reseve memory for matrices */
-    I = (int *) malloc(nz * sizeof(int)); // Rows pointer
-    J = (int *) malloc(nz * sizeof(int)); // Columns pointer
-    vals = (double *) malloc(nz * sizeof(double)); // Values pointer
+        /* Symmetric, hermitian and skew-symmetric files store one triangle, the mirrored entries are added while reading */
+        bool skew = mm_is_skew(matcode); // Mirrored entries with the opposite sign
+        bool hermitian = mm_is_hermitian(matcode); // Mirrored entries conjugated
+        bool mirrored = mm_is_symmetric(matcode) || skew || hermitian;
+        bool pattern = mm_is_pattern(matcode); // No values in the file, every entry is 1
+        bool complex_values = mm_is_complex(matcode); // Imaginary parts in vals_im
+        if (mirrored && nz > NZ_MAX / 2) {
+            printf("The mirrored matrix has too many entries, the code must be compiled with -DLONG_NZ\n");
+            exit(1);
+        }
+        nz_t max_nz = mirrored ? 2 * nz : nz;
+
+        /* reseve memory for matrices */
+        I = (int *) malloc((size_t) max_nz * sizeof(int)); // Rows pointer
+        J = (int *) malloc((size_t) max_nz * sizeof(int)); // Columns pointer
+        vals = (double *) malloc((size_t) max_nz * sizeof(double)); // Values pointer
+        if (complex_values) {
+            vals_im = (double *) malloc((size_t) max_nz * sizeof(double));
+        }
+        if (!I || !J || !vals || (complex_values && !vals_im)) {
+            printf("Failed to allocate memory for %ld entries\n", (long) max_nz);
+            exit(1);
+        }
 
 
-    /* NOTE: when reading in doubles, ANSI C requires the use of the "l"  */
-    /*   specifier as in "%lg", "%lf", "%le", otherwise errors will occur */
-    /*  (ANSI C X3.159-1989, Sec. 4.9.6.2, p. 136 lines 13-15)            */
-    for (i=0; i<nz; i++) {
-        fscanf(f, "%d %d %lg\n", &I[i], &J[i], &vals[i]);
-        I[i]--;  /* adjust from 1-based to 0-based */
-        J[i]--;
+        /* Entries parsed with parse_int/parse_double instead of fscanf (same values, no locale handling) */
+        char line[256];
+        nz_t stored = 0; // Entries stored, including the mirrored ones
+        for (nz_t e = 0; e < file_nz; e++) {
+            if (!fgets(line, sizeof(line), f)) {
+                printf("Unexpected end of file at entry %ld\n", (long) e+1);
+                exit(1);
+            }
+            int row, col;
+            double val = 1.0, val_im = 0.0;
+            char *p = parse_int(line, &row);
+            p = parse_int(p, &col);
+            if (!pattern) {
+                p = parse_double(p, &val);
+            }
+            if (complex_values) {
+                parse_double(p, &val_im);
+            }
+            row--;  /* adjust from 1-based to 0-based */
+            col--;
+
+            I[stored] = row;
+            J[stored] = col;
+            vals[stored] = val;
+            if (complex_values) {
+                vals_im[stored] = val_im;
+            }
+            stored++;
+            if (mirrored && row != col) { // The diagonal is stored only once
+                I[stored] = col;
+                J[stored] = row;
+                vals[stored] = skew ? -val : val;
+                if (complex_values) {
+                    vals_im[stored] = (skew || hermitian) ? -val_im : val_im;
+                }
+                stored++;
+            }
+        }
+        nz = stored;
+
+        if (f !=stdin)
+            fclose(f);
+
+        // Complex matrices go through their own kernels, in the interleaved and split layouts
+        if (complex_values) {
+            char results_filename[300];
+            char *base_filename = strrchr(argv[1], '/');
+            base_filename = base_filename ? base_filename + 1 : argv[1];
+            snprintf(results_filename, sizeof(results_filename), "./results/to_plot/%s_complex_results.txt", base_filename);
+            complex_benchmark(M, N, nz, I, J, vals, vals_im, results_filename);
+            free(I);
+            free(J);
+            free(vals);
+            free(vals_im);
+            return 0;
+        }
     }
 
-    if (f !=stdin)
-        fclose(f);
-
     // Print the matrix
     /*mm_write_banner(stdout, matcode);
     mm_write_mtx_crd_size(stdout, M, N, nz);
@@ -202,9 +809,9 @@ int main(int argc, char *argv[])
     bubbleSort(I, J, vals, nz);
     
     //Conversion from COO to CSR
-    int index = 0;
+    nz_t index = 0;
     int current_row = 0;
-    int *row_ptr = (int *) malloc((M+1) * sizeof(int));
+    nz_t *row_ptr = (nz_t *) malloc((M+1) * sizeof(nz_t));
     row_ptr[0] = 0;
     row_ptr[1] = 0; // This is enough to initialie the array;
 
@@ -223,6 +830,10 @@ int main(int argc, char *argv[])
             row_ptr[current_row+1] = row_ptr[current_row];
         }
     }
+    // Rows after the last non-zero are empty
+    for (int r = current_row + 1; r < M; r++) {
+        row_ptr[r+1] = row_ptr[r];
+    }
 
     // Print matrix in CSR format
     /*printf("CSR Row pointer:\n");
@@ -441,7 +1052,11 @@ int main(int argc, char *argv[])
 
     char filename[96] = "./results/to_plot/";
     char filename_part[32] = "";
-    strcat(filename_part, argv[1]);
+    if (generated) {
+        snprintf(filename_part, sizeof(filename_part), "%s_%s_%s_%s", argv[2], argv[3], argv[4], argv[5]);
+    } else {
+        strcat(filename_part, argv[1]);
+    }
     // Remove path from filename
     char *base_filename = strrchr(filename_part, '/');
     if (base_filename != NULL) {
@@ -472,6 +1087,17 @@ int main(int argc, char *argv[])
     fprintf(fptr, print);
 
     fclose(fptr);
+
+    if (transpose) {
+        char transpose_filename[160];
+        snprintf(transpose_filename, sizeof(transpose_filename), "./results/to_plot/%s_transpose_results.txt", base_filename);
+        transpose_benchmark(M, N, row_ptr, J, vals, transpose_filename);
+    }
+    if (csb) {
+        char csb_filename[160];
+        snprintf(csb_filename, sizeof(csb_filename), "./results/to_plot/%s_csb_results.txt", base_filename);
+        csb_benchmark(M, N, row_ptr, J, vals, csb_filename);
+    }
     
 
 
@@ -1,5 +1,6 @@
 #include <stdbool.h>
 #include <stdio.h>
+#include "bubblesort.h"
 
 void swap(int* xp, int* yp){
     int temp = *xp;
@@ -14,8 +15,8 @@ void swap_double(double* xp, double* yp){
 }
 
 // An optimized version of Bubble Sort
-void bubbleSort(int arr1[], int arr2[], double arr3[], int n){
-    int i, j;
+void bubbleSort(int arr1[], int arr2[], double arr3[], nz_t n){
+    nz_t i, j;
     bool swapped;
     for (i = 0; i < n - 1; i++) {
         swapped = false;
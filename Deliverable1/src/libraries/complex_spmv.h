@@ -0,0 +1,18 @@
+#ifndef COMPLEX_SPMV_H
+#define COMPLEX_SPMV_H
+
+#include <stdbool.h>
+#include "index_types.h"
+
+// Interleaved layout: element j of values, vector and result is (re, im) at [2j] and [2j+1]
+// Split layout: real and imaginary parts in two arrays of the same length
+void SpMV_csr_complex(int M, nz_t *row_ptr, int *col_idx, double *vals, double *vector, double *result);
+void SpMV_csr_complex_split(int M, nz_t *row_ptr, int *col_idx, double *vals_re, double *vals_im,
+                            double *vector_re, double *vector_im, double *result_re, double *result_im);
+void SpMV_csr_complex_float(int M, nz_t *row_ptr, int *col_idx, float *vals, double *vector, double *result);
+void SpMV_csr_complex_split_float(int M, nz_t *row_ptr, int *col_idx, float *vals_re, float *vals_im,
+                                  double *vector_re, double *vector_im, double *result_re, double *result_im);
+bool complex_to_split(nz_t n, double *in, double **re, double **im);
+void split_to_complex(nz_t n, double *re, double *im, double *out);
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef FAST_PARSE_H
+#define FAST_PARSE_H
+
+// Both skip leading blanks and return the first character after the number, like strtol and strtod
+char *parse_int(char *p, int *value);
+char *parse_double(char *p, double *value);
+
+#endif
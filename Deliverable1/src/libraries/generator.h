@@ -0,0 +1,13 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "index_types.h"
+
+void philox4x32(const uint32_t counter[4], uint64_t seed, uint32_t out[4]);
+bool generate_matrix(int rows, int cols, int percent_nonzero, int **I, int **J, double **vals, nz_t *nz);
+bool generate_rows(uint64_t seed, int start_row, int end_row, int start_col, int end_col, int percent_nonzero, nz_t **row_ptr, int **col_idx, double **vals, nz_t *nz);
+bool coo_to_csr(nz_t nz, int start_row, int M, int *I, int *J, double *vals, nz_t **row_ptr);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,24 @@
+#ifndef INDEX_TYPES_H
+#define INDEX_TYPES_H
+
+#include <stdint.h>
+#include <limits.h>
+
+/*
+ * Width of the non-zero indices: row pointers, non-zero counts and offsets into col_idx/vals.
+ * Column indices and row counts stay int, 32 bit columns already address vectors of 16 GB,
+ * while the non-zeros of a matrix pass 2^31 much earlier.
+ * Compile everything with -DLONG_NZ for 64-bit row pointers, the default stays 32-bit
+ * (half the row pointer traffic); a matrix that does not fit is refused instead of overflowing.
+ */
+#ifdef LONG_NZ
+typedef int64_t nz_t;
+#define NZ_MAX INT64_MAX
+#define MPI_NZ MPI_INT64_T // Only expanded where mpi.h is included
+#else
+typedef int nz_t;
+#define NZ_MAX INT_MAX
+#define MPI_NZ MPI_INT
+#endif
+
+#endif
@@ -3,15 +3,22 @@ set -e  # exit on first error
 
 MATRIX_GROUP=$1
 DESIRED_MATRIX=$2
+MODE=$3 # "compressed" keeps the archive, del2_r reads it directly
 
 if [ -z "$DESIRED_MATRIX" ]; then
-  echo "Usage: $0 MATRIX_NAME"
+  echo "Usage: $0 MATRIX_GROUP MATRIX_NAME [compressed]"
   exit 1
 fi
 
 URL="https://suitesparse-collection-website.herokuapp.com/MM/$MATRIX_GROUP/$DESIRED_MATRIX.tar.gz"
 
 wget -O "$DESIRED_MATRIX.tar.gz" "$URL"
+
+if [ "$MODE" = "compressed" ]; then
+  mv "$DESIRED_MATRIX.tar.gz" "matrices/$DESIRED_MATRIX.tar.gz"
+  exit 0
+fi
+
 tar -xzf "$DESIRED_MATRIX.tar.gz"
 
 mv "$DESIRED_MATRIX/$DESIRED_MATRIX.mtx" "matrices/$DESIRED_MATRIX.mtx"
@@ -0,0 +1,359 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include "libraries/SpMV.h"
+#include "libraries/complex_spmv.h"
+#include "libraries/data_management.h"
+#include "libraries/matrix_reading.h"
+#include "libraries/vector_distribution.h"
+#include <mpi.h>
+
+/*
+ * Complex SpMV benchmark: the rows of a complex Matrix Market file (real files are read with imaginary
+ * part 0) are split in blocks among the working processes as in execute_mpi_reading.c. Each iteration
+ * rank 0 broadcasts a new complex vector and every working process multiplies its rows with the four
+ * storages of its values, one after the other, so their times can be compared:
+ *   interleaved         (re, im) pairs for values, vector and result
+ *   split               real and imaginary parts in separate arrays
+ *   interleaved_float   interleaved values stored in float, vector and accumulation in double
+ *   split_float         split values stored in float, vector and accumulation in double
+ * Rank 0 checks each result against its own interleaved double product of the whole matrix.
+ */
+
+#define LAYOUTS 4
+#define LAYOUT_INTERLEAVED 0
+#define LAYOUT_SPLIT 1
+#define LAYOUT_INTERLEAVED_FLOAT 2
+#define LAYOUT_SPLIT_FLOAT 3
+static const char *layout_names[LAYOUTS] = {"interleaved", "split", "interleaved_float", "split_float"};
+
+int main(int argc, char *argv[]) {
+    int rank, size, processes, num_iterations;
+    MPI_Status status;
+    char filename[256] = "";
+    char result_filename[256] = "";
+
+    nz_t *row_ptr = NULL; // Initialize pointers to avoid problems with free()
+    int *J = NULL;
+    double *vals = NULL, *vector = NULL, *results = NULL; // Interleaved complex values
+    double *vals_re = NULL, *vals_im = NULL, *vector_re = NULL, *vector_im = NULL; // Split copies
+    double *results_re = NULL, *results_im = NULL;
+    float *vals_f = NULL, *vals_re_f = NULL, *vals_im_f = NULL; // Float copies
+    int M; // Number of rows
+    int N; // Number of columns
+    nz_t nz; // Non-zero entries, after expanding the mirrored ones
+    MM_typecode matcode; // Matrix Market type of the file
+    //srand(42); // For debugging purposes
+    srand(time(NULL));
+
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    processes = size-1; // Rank 0 is not included
+
+
+    if (size < 2) {
+        if (rank == 0) {
+            fprintf(stderr, "Error: run with at least 2 processes.\n");
+            fflush(stderr);
+        }
+        MPI_Finalize();
+        exit(1);
+    }
+
+    /* Check the right amount of argument */
+    if (argc != 4) {
+        if (rank == 0) {
+            fprintf(stderr, "Intended usage: %s [matrix-market-filename] [iterations] [plot-result-file]\n", argv[0]);
+            fflush(stderr);
+        }
+        MPI_Finalize();
+        exit(1);
+    }
+
+    num_iterations = atoi(argv[2]); // Number of products of each layout, for averaging
+    if (num_iterations < 1) {
+        if (rank == 0) {
+            fprintf(stderr, "The number of iterations must be at least 1\n");
+            fflush(stderr);
+        }
+        MPI_Finalize();
+        exit(1);
+    }
+    snprintf(filename, sizeof(filename), "%s", argv[1]);
+    snprintf(result_filename, sizeof(result_filename), "%s", argv[3]); // File to store results
+
+    /* Allocating memory */
+    double t_start, t_end;
+    double *computation_time[LAYOUTS];
+    double *communication_time = (double *) calloc(num_iterations, sizeof(double));
+    double *not_par_computation_time = (double *) calloc(num_iterations, sizeof(double));
+    bool allocated = communication_time && not_par_computation_time;
+    for (int layout = 0; layout < LAYOUTS; layout++) {
+        computation_time[layout] = (double *) calloc(num_iterations, sizeof(double));
+        allocated = allocated && computation_time[layout];
+    }
+    if (!allocated) {
+        fprintf(stderr, "Process %d failed to allocate memory for timing arrays\n", rank);
+        fflush(stderr);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+
+    /* Matrix type and size, then the rows of each process */
+    int start_row = 0, end_row = 0;
+    int *rows_distribution = NULL;
+    if (rank == 0) {
+        printf("Process %d is checking the matrix: %s\n", rank, filename);
+        fflush(stdout);
+        if (!check_matrix_file(filename, &M, &N, &nz, matcode)) {
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        if (!mm_is_complex(matcode)) {
+            printf("The matrix is not complex, its values are read with imaginary part 0.\n");
+            fflush(stdout);
+        }
+
+        rows_distribution = (int *) malloc(size * sizeof(int));
+        if (!rows_distribution) {
+            fprintf(stderr, "Process %d failed to allocate memory for rows distribution\n", rank);
+            fflush(stderr);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        rows_distribution[0] = 0;
+        for (int i = 0; i < processes; i++) {
+            rows_distribution[i+1] = rows_distribution[i] + M / processes + (i < M % processes ? 1 : 0);
+        }
+    }
+    MPI_Bcast(matcode, 4, MPI_CHAR, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&M, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&N, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (rank == 0) {
+        for (int i = 0; i < processes; i++) {
+            MPI_Send(&rows_distribution[i], 1, MPI_INT, i+1, 0, MPI_COMM_WORLD); // Start row
+            MPI_Send(&rows_distribution[i+1], 1, MPI_INT, i+1, 0, MPI_COMM_WORLD); // End row
+        }
+        start_row = 0; // Rank 0 reads the whole matrix for the reference
+        end_row = M;
+    } else {
+        MPI_Recv(&start_row, 1, MPI_INT, 0, 0, MPI_COMM_WORLD, &status);
+        MPI_Recv(&end_row, 1, MPI_INT, 0, 0, MPI_COMM_WORLD, &status);
+    }
+    int local_M = end_row - start_row;
+
+    /* Read the rows, the matrix stays the same for every iteration */
+    if (!read_matrix_to_csr_complex_partial(filename, start_row, end_row, matcode, &nz, &row_ptr, &J, &vals)) {
+        fprintf(stderr, "Process %d failed reading its part of the matrix: %s\n", rank, filename);
+        fflush(stderr);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    vector = (double *) malloc(2 * ((size_t) N + 1) * sizeof(double));
+    results = (double *) malloc(2 * ((size_t) local_M + 1) * sizeof(double));
+    if (!vector || !results) {
+        fprintf(stderr, "Process %d failed to allocate memory for the vectors\n", rank);
+        fflush(stderr);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    /* Split and float copies of the values for the other layouts */
+    double *reference = NULL;
+    if (rank == 0) {
+        reference = (double *) malloc(2 * ((size_t) M + 1) * sizeof(double));
+        if (!reference) {
+            fprintf(stderr, "Process %d failed to allocate memory for the reference\n", rank);
+            fflush(stderr);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    } else {
+        results_re = (double *) malloc(((size_t) local_M + 1) * sizeof(double));
+        results_im = (double *) malloc(((size_t) local_M + 1) * sizeof(double));
+        if (!results_re || !results_im
+            || !complex_to_split(nz, vals, &vals_re, &vals_im)
+            || !double_to_float(2 * nz, vals, &vals_f)
+            || !double_to_float(nz, vals_re, &vals_re_f)
+            || !double_to_float(nz, vals_im, &vals_im_f)) {
+            fprintf(stderr, "Process %d failed building the copies of its values\n", rank);
+            fflush(stderr);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        printf("Process %d: rows %d to %d, %ld non-zeros, %.1f MB of values in double, %.1f MB in float\n", rank,
+               start_row, end_row - 1, (long) nz, 2.0 * nz * sizeof(double) / 1e6, 2.0 * nz * sizeof(float) / 1e6);
+        fflush(stdout);
+    }
+
+
+    for (int iter = 0; iter < num_iterations; iter++) {
+        /* New random complex vector */
+        if (rank == 0) {
+            for (size_t i = 0; i < 2 * (size_t) N; i++) {
+                vector[i] = (rand() % 9) + 1;
+            }
+        }
+        MPI_Barrier(MPI_COMM_WORLD);
+        t_start = MPI_Wtime();
+        if (!distribute_vector(VECTOR_BCAST, vector, 2 * N, VECTOR_CHUNK)) {
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        t_end = MPI_Wtime();
+        communication_time[iter] += (t_end - t_start);
+
+        if (rank == 0) {
+            printf("Iteration: %d - Computation started.\n", iter+1);
+            fflush(stdout);
+
+            /* Compute the reference */
+            double local_start = MPI_Wtime();
+            SpMV_csr_complex(M, row_ptr, J, vals, vector, reference);
+            not_par_computation_time[iter] = MPI_Wtime() - local_start;
+
+            /* Receive and check the results of every layout */
+            for (int layout = 0; layout < LAYOUTS; layout++) {
+                double *gathered = (double *) malloc(2 * ((size_t) M + 1) * sizeof(double));
+                if (!gathered) {
+                    fprintf(stderr, "Iteration: %d - Process %d failed to allocate memory for results\n", iter+1, rank);
+                    fflush(stderr);
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+                t_start = MPI_Wtime();
+                for (int i = 0; i < processes; i++) {
+                    int rows = rows_distribution[i+1] - rows_distribution[i];
+                    MPI_Recv(gathered + 2 * (size_t) rows_distribution[i], 2 * rows, MPI_DOUBLE, i+1, 0, MPI_COMM_WORLD, &status);
+                }
+                t_end = MPI_Wtime();
+                communication_time[iter] += (t_end - t_start);
+
+                if (layout == LAYOUT_INTERLEAVED_FLOAT || layout == LAYOUT_SPLIT_FLOAT) {
+                    // Float storage cannot match the double result exactly, report the error instead
+                    double max_abs, relative;
+                    compute_error(reference, gathered, 2 * M, &max_abs, &relative);
+                    printf("\tIteration: %d - %s: mixed precision error against double: max absolute %e, relative %e.\n",
+                           iter+1, layout_names[layout], max_abs, relative);
+                } else if (check_results(reference, gathered, 2 * M)) {
+                    printf("\tIteration: %d - %s: Results are correct for MPI parallelization.\n", iter+1, layout_names[layout]);
+                } else {
+                    printf("\tIteration: %d - %s: Results are NOT correct for MPI parallelization.\n", iter+1, layout_names[layout]);
+                }
+                fflush(stdout);
+                free(gathered);
+            }
+
+            /* Receive computation times from processes */
+            for (int i = 0; i < processes; i++) {
+                double proc_comp_time[LAYOUTS];
+                MPI_Recv(proc_comp_time, LAYOUTS, MPI_DOUBLE, i+1, 0, MPI_COMM_WORLD, &status);
+                for (int layout = 0; layout < LAYOUTS; layout++) {
+                    computation_time[layout][iter] += proc_comp_time[layout];
+                }
+            }
+        } else {
+            double local_comp_time[LAYOUTS];
+            for (int layout = 0; layout < LAYOUTS; layout++) {
+                // The vector is split outside the timed product, as the values are
+                if (layout == LAYOUT_SPLIT) {
+                    free(vector_re);
+                    free(vector_im);
+                    if (!complex_to_split(N, vector, &vector_re, &vector_im)) {
+                        MPI_Abort(MPI_COMM_WORLD, 1);
+                    }
+                }
+
+                t_start = MPI_Wtime();
+                if (layout == LAYOUT_INTERLEAVED) {
+                    SpMV_csr_complex(local_M, row_ptr, J, vals, vector, results);
+                } else if (layout == LAYOUT_SPLIT) {
+                    SpMV_csr_complex_split(local_M, row_ptr, J, vals_re, vals_im, vector_re, vector_im, results_re, results_im);
+                } else if (layout == LAYOUT_INTERLEAVED_FLOAT) {
+                    SpMV_csr_complex_float(local_M, row_ptr, J, vals_f, vector, results);
+                } else {
+                    SpMV_csr_complex_split_float(local_M, row_ptr, J, vals_re_f, vals_im_f, vector_re, vector_im, results_re, results_im);
+                }
+                t_end = MPI_Wtime();
+                local_comp_time[layout] = t_end - t_start;
+
+                /* Send back results to rank 0, always interleaved */
+                if (layout == LAYOUT_SPLIT || layout == LAYOUT_SPLIT_FLOAT) {
+                    split_to_complex(local_M, results_re, results_im, results);
+                }
+                MPI_Send(results, 2 * local_M, MPI_DOUBLE, 0, 0, MPI_COMM_WORLD);
+            }
+
+            /* Send computation times to rank 0 */
+            MPI_Send(local_comp_time, LAYOUTS, MPI_DOUBLE, 0, 0, MPI_COMM_WORLD);
+        }
+
+        // Barrier to synchronize before next iteration
+        MPI_Barrier(MPI_COMM_WORLD);
+    }
+
+    /* Print overall times and speedup of each layout */
+    if (rank == 0) {
+        double comm_time = 0.0;
+        double not_par_comp_time = 0.0;
+        double avg_comp_time[LAYOUTS], speedup[LAYOUTS];
+
+        remove_outlier(num_iterations, communication_time, &comm_time);
+        remove_outlier(num_iterations, not_par_computation_time, &not_par_comp_time);
+
+        printf("=-=\n");
+        printf("Matrix %s - %d x %d - %d working processes\n", filename, M, N, processes);
+        printf("Average communication time across processes: %f seconds.\n", comm_time / processes);
+        printf("Unparallelized computation time (interleaved): %f seconds.\n", not_par_comp_time);
+        for (int layout = 0; layout < LAYOUTS; layout++) {
+            double comp_time = 0.0;
+            remove_outlier(num_iterations, computation_time[layout], &comp_time);
+            avg_comp_time[layout] = comp_time / processes; // Average per process
+            speedup[layout] = not_par_comp_time / avg_comp_time[layout];
+            printf("\t%-17s: average computation time %f seconds, speedup %f\n", layout_names[layout], avg_comp_time[layout], speedup[layout]);
+        }
+        printf("Split over interleaved time: %.3f in double, %.3f in float\n",
+               avg_comp_time[LAYOUT_SPLIT] / avg_comp_time[LAYOUT_INTERLEAVED],
+               avg_comp_time[LAYOUT_SPLIT_FLOAT] / avg_comp_time[LAYOUT_INTERLEAVED_FLOAT]);
+        printf("=-=\n\n");
+        fflush(stdout);
+
+        /* Write results to file */
+        FILE *f;
+        if ((f = fopen(result_filename, "a")) == NULL) {
+            fprintf(stderr, "Could not open file: %s\n", result_filename);
+            fflush(stderr);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        fprintf(f, "#Matrix: %s - Row: %d - Columns: %d - Working_processes: %d\n", filename, M, N, processes);
+        fprintf(f, "avg_comm_time: %f\n", comm_time / processes);
+        fprintf(f, "not_par_comp_time: %f\n", not_par_comp_time);
+        for (int layout = 0; layout < LAYOUTS; layout++) {
+            fprintf(f, "%s_avg_comp_time: %f\n", layout_names[layout], avg_comp_time[layout]);
+            fprintf(f, "%s_speedup: %f\n", layout_names[layout], speedup[layout]);
+        }
+        fflush(f);
+        fclose(f);
+    }
+
+
+    free(row_ptr);
+    free(J);
+    free(vals);
+    free(vector);
+    free(results);
+    free(reference);
+    free(rows_distribution);
+    free(vals_re);
+    free(vals_im);
+    free(vector_re);
+    free(vector_im);
+    free(results_re);
+    free(results_im);
+    free(vals_f);
+    free(vals_re_f);
+    free(vals_im_f);
+    for (int layout = 0; layout < LAYOUTS; layout++) {
+        free(computation_time[layout]);
+    }
+    free(communication_time);
+    free(not_par_computation_time);
+
+    MPI_Finalize();
+    return 0;
+}
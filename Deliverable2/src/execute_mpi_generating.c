@@ -2,9 +2,17 @@
 #include <stdlib.h>
 #include <time.h>
 #include <string.h>
+#include <limits.h>
 #include "libraries/SpMV.h"
 #include "libraries/data_management.h"
 #include "libraries/generator.h"
+#include "libraries/matrix_families.h"
+#include "libraries/csr_du.h"
+#include "libraries/csr_vi.h"
+#include "libraries/csb.h"
+#include "libraries/dcsr.h"
+#include "libraries/shared_vector.h"
+#include "libraries/vector_distribution.h"
 #include <mpi.h>
 
 int main(int argc, char *argv[]) {
@@ -12,11 +20,24 @@ int main(int argc, char *argv[]) {
     MPI_Status status;
     char result_filename[256] = "";
 
-    int *I = NULL, *J = NULL, *row_ptr = NULL; // Initialize to null to avoid problems with free()
+    int *I = NULL, *J = NULL; // Initialize to null to avoid problems with free()
+    nz_t *row_ptr = NULL;
     double *vals = NULL, *vector = NULL, *results = NULL;
+    uint8_t *du_ctl = NULL; // CSR-DU stream, used with --csr-du
+    nz_t du_ctl_size = 0;
+    nz_t *csb_blk_ptr = NULL; // CSB arrays, used with --csb
+    uint16_t *csb_row = NULL, *csb_col = NULL;
+    double *csb_vals = NULL;
+    int *dcsr_row_ids = NULL; // DCSR non-empty rows, used when most of the local rows are empty
+    nz_t *dcsr_ptr = NULL;
+    int dcsr_rows = 0;
+    double *vi_dict = NULL; // Value dictionary and codes, used with --vi
+    void *vi_codes = NULL;
+    int vi_dict_size = 0, vi_code_bytes = 0;
+    float *vals_f = NULL, *vector_f = NULL; // Float copies, used with --float and --float-x
     int M; // Number of rows
     int N; // Number of columns
-    int nz; // Total number of non-zero entries
+    nz_t nz; // Total number of non-zero entries (see index_types.h)
     //srand(42); // For debugging purposes
     srand(time(NULL));
 
@@ -36,9 +57,103 @@ int main(int argc, char *argv[]) {
     }
 
     /* Check the right amount of argument and open the file */
-    if (argc != 5) {
+    if (argc < 5) {
         if (rank == 0) {
-            fprintf(stderr, "Intended usage: %s [martix-market-filename] [number-of-threads]\n", argv[0]);
+            fprintf(stderr, "Intended usage: %s [iterations] [plot-result-file] [n-rows] [n-columns] [options]\n", argv[0]);
+            fprintf(stderr, "Options: --csr-du, --vi, --float, --float-x, --spmm [k], --2d, --node-shared, --local-gen, --seed [n],\n");
+            fprintf(stderr, "         --vector-dist [send|bcast|scatter|pipeline], --family [uniform|rmat|laplace2d|laplace3d|blockdiag|denserows],\n");
+            fprintf(stderr, "         --density [percent], --csb [beta], --no-dcsr\n");
+            fflush(stderr);
+        }
+        MPI_Finalize();
+        exit(1);
+    }
+
+    /* Optional flags, after the required arguments */
+    bool use_csr_du = false; // Compressed column indices for the working processes
+    bool use_vi = false; // Value dictionary for the working processes, when there are few distinct values
+    bool use_csb = false; // Square blocks with 16 bit in-block indices for the working processes
+    int csb_beta = 0; // Block size of --csb, 0 picks it from the size of the local part
+    bool use_dcsr = true; // Only the non-empty local rows when most are empty, disabled by --no-dcsr
+    int float_mode = 0; // 1: values stored in float, 2: values and vector stored in float
+    int block_k = 1; // Number of vectors multiplied at once (SpMM), 1 is the plain SpMV
+    bool use_2d = false; // Checkerboard blocks over a grid of working processes instead of row blocks
+    bool use_node_shared = false; // One copy of the vector per node, in a shared memory window
+    int vector_dist = VECTOR_BCAST; // How rank 0 distributes the vector (see vector_distribution.h)
+    bool local_gen = false; // Every working process generates its own rows instead of receiving them
+    bool seed_given = false;
+    uint64_t seed = 0; // Key of the generator with --local-gen, random for each iteration unless given
+    int family = FAMILY_UNIFORM; // Structure of the generated matrix (see matrix_families.h)
+    int percent_nonzero = 9; // Density of the generated matrix
+    for (int a = 5; a < argc; a++) {
+        if (strcmp(argv[a], "--csr-du") == 0) {
+            use_csr_du = true;
+        } else if (strcmp(argv[a], "--vi") == 0) {
+            use_vi = true;
+        } else if (strcmp(argv[a], "--no-dcsr") == 0) {
+            use_dcsr = false;
+        } else if (strcmp(argv[a], "--csb") == 0) {
+            use_csb = true;
+            if (a + 1 < argc && atoi(argv[a+1]) > 0) {
+                csb_beta = atoi(argv[++a]);
+                if (csb_beta > CSB_MAX_BETA) {
+                    if (rank == 0) {
+                        fprintf(stderr, "The CSB block size can be at most %d\n", CSB_MAX_BETA);
+                        fflush(stderr);
+                    }
+                    MPI_Finalize();
+                    exit(1);
+                }
+            }
+        } else if (strcmp(argv[a], "--float") == 0) {
+            float_mode = 1;
+        } else if (strcmp(argv[a], "--float-x") == 0) {
+            float_mode = 2;
+        } else if (strcmp(argv[a], "--2d") == 0) {
+            use_2d = true;
+        } else if (strcmp(argv[a], "--vector-dist") == 0 && a + 1 < argc && parse_vector_distribution(argv[a+1], &vector_dist)) {
+            a++;
+        } else if (strcmp(argv[a], "--local-gen") == 0) {
+            local_gen = true;
+        } else if (strcmp(argv[a], "--seed") == 0 && a + 1 < argc) {
+            seed = strtoull(argv[++a], NULL, 10);
+            seed_given = true;
+        } else if (strcmp(argv[a], "--family") == 0 && a + 1 < argc && parse_matrix_family(argv[a+1], &family)) {
+            a++;
+        } else if (strcmp(argv[a], "--density") == 0 && a + 1 < argc) {
+            percent_nonzero = atoi(argv[++a]);
+            if (percent_nonzero < 0 || percent_nonzero > 100) {
+                if (rank == 0) {
+                    fprintf(stderr, "The density must be a percentage between 0 and 100\n");
+                    fflush(stderr);
+                }
+                MPI_Finalize();
+                exit(1);
+            }
+        } else if (strcmp(argv[a], "--node-shared") == 0) {
+            use_node_shared = true;
+        } else if (strcmp(argv[a], "--spmm") == 0 && a + 1 < argc) {
+            block_k = atoi(argv[++a]);
+            if (block_k < 1) {
+                if (rank == 0) {
+                    fprintf(stderr, "The SpMM block size must be at least 1\n");
+                    fflush(stderr);
+                }
+                MPI_Finalize();
+                exit(1);
+            }
+        } else {
+            if (rank == 0) {
+                fprintf(stderr, "Unknown option: %s\n", argv[a]);
+                fflush(stderr);
+            }
+            MPI_Finalize();
+            exit(1);
+        }
+    }
+    if (use_csr_du + use_vi + use_csb + (float_mode > 0) + (block_k > 1) > 1) {
+        if (rank == 0) {
+            fprintf(stderr, "Options --csr-du, --vi, --csb, --float(-x) and --spmm cannot be combined\n");
             fflush(stderr);
         }
         MPI_Finalize();
@@ -70,22 +185,92 @@ int main(int argc, char *argv[]) {
     /* Read matrix dimensions from command line */
     M = atoi(argv[3]); // Number of rows
     N = atoi(argv[4]); // Number of columns
+    if ((long long) (M > N ? M : N) * block_k > INT_MAX) {
+        // The blocks are indexed and counted with int, by the loops and in the MPI calls
+        if (rank == 0) {
+            fprintf(stderr, "The block of %d vectors of %d entries is too large\n", block_k, M > N ? M : N);
+            fflush(stderr);
+        }
+        MPI_Finalize();
+        exit(1);
+    }
+
+
+    /* Build the process grid for the 2D decomposition */
+    // Working process i+1 owns block (i / grid_q, i % grid_q): the rows of the grid row and the columns of the grid column.
+    // The vector part of a grid column is sent to its diagonal process and broadcast along the column,
+    // the partial results of a grid row are reduced on its diagonal process, so each one only moves O(M / grid_q) values.
+    int grid_q = 0, grid_row = 0, grid_col = 0;
+    MPI_Comm row_comm = MPI_COMM_NULL, col_comm = MPI_COMM_NULL;
+    if (use_2d) {
+        while ((grid_q+1) * (grid_q+1) <= processes) {
+            grid_q++;
+        }
+        if (grid_q * grid_q != processes || block_k > 1 || M != N) {
+            if (rank == 0) {
+                fprintf(stderr, "Option --2d needs a square number of working processes, a square matrix and no --spmm\n");
+                fflush(stderr);
+            }
+            MPI_Finalize();
+            exit(1);
+        }
+        if (rank > 0) {
+            grid_row = (rank-1) / grid_q;
+            grid_col = (rank-1) % grid_q;
+        }
+        // Rank 0 is not part of the grid, in row_comm the rank is the grid column and in col_comm the grid row
+        MPI_Comm_split(MPI_COMM_WORLD, rank == 0 ? MPI_UNDEFINED : grid_row, grid_col, &row_comm);
+        MPI_Comm_split(MPI_COMM_WORLD, rank == 0 ? MPI_UNDEFINED : grid_col, grid_row, &col_comm);
+    }
+    int blocks = use_2d ? grid_q : processes; // Number of row (and, with --2d, column) blocks
+    if (use_2d && use_node_shared) {
+        if (rank == 0) {
+            fprintf(stderr, "Options --2d and --node-shared cannot be combined\n");
+            fflush(stderr);
+        }
+        MPI_Finalize();
+        exit(1);
+    }
+
+    /* Node communicators for the shared vector */
+    MPI_Comm node_comm = MPI_COMM_NULL, leader_comm = MPI_COMM_NULL;
+    MPI_Win vector_win = MPI_WIN_NULL; // Window holding the vector of the node, with --node-shared
+    if (use_node_shared) {
+        node_comms_create(rank, &node_comm, &leader_comm);
+    }
 
     for (int iter = 0; iter < num_iterations; iter++) {
         if (rank == 0) {
 
             /* Initial creation of the matrix */
             printf("Iteration: %d - Process %d is creating the matrix\n", iter+1, rank);
-            if (!generate_matrix(M, N, 9, &I, &J, &vals, &nz)) {
+            if (!seed_given) {
+                seed = ((uint64_t) rand() << 31) ^ (uint64_t) rand();
+            }
+            if (local_gen) {
+                // Every process generates its rows from the same seed, rank 0 the whole matrix for the reference
+                MPI_Bcast(&seed, 1, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+                double gen_start = MPI_Wtime();
+                if (!generate_family_rows(family, seed, M, N, 0, M, 0, N, percent_nonzero, &row_ptr, &J, &vals, &nz)) {
+                    fprintf(stderr,"Iteration: %d - Process %d failed to generate matrix\n", iter+1, rank);
+                    fflush(stderr);
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+                if (iter == 0) {
+                    printf("Process %d generated the whole matrix (%ld non-zeros) in %f seconds\n", rank, (long) nz, MPI_Wtime() - gen_start);
+                    fflush(stdout);
+                }
+            } else if ((family == FAMILY_UNIFORM) ? !generate_matrix(M, N, percent_nonzero, &I, &J, &vals, &nz)
+                                                  : !generate_family_matrix(family, seed, M, N, percent_nonzero, &I, &J, &vals, &nz)) {
                 fprintf(stderr,"Iteration: %d - Process %d failed to generate matrix\n", iter+1, rank);
                 fflush(stderr);
                 MPI_Abort(MPI_COMM_WORLD, 1);
             }
            
 
-            /* Compute rows range for each process */
-            int rows_per_process = M / processes;
-            int remaining_rows = M % processes;
+            /* Compute rows range for each process (for each grid row and column with --2d) */
+            int rows_per_process = M / blocks;
+            int remaining_rows = M % blocks;
 
             int *rows_distribution = (int *) malloc(size * sizeof(int));
             if (!rows_distribution) {
@@ -95,7 +280,7 @@ int main(int argc, char *argv[]) {
             }
             rows_distribution[0] = 0; // Rank 0 does not process rows
 
-            for (int i = 0; i < processes; i++) { // Reminder that "processes = size - 1" due to rank 0
+            for (int i = 0; i < blocks; i++) { // Reminder that "processes = size - 1" due to rank 0
                 rows_distribution[i+1] = rows_distribution[i] + rows_per_process; // Similar to CSR format
                 if (i < remaining_rows) {
                     rows_distribution[i+1]++;
@@ -113,69 +298,74 @@ int main(int argc, char *argv[]) {
             printf("Iteration: %d - Process %d is sending rows distribution to other processes.\n", iter+1, rank);
             fflush(stdout);
             for (int i = 0; i < processes; i++) {
-                MPI_Send(&rows_distribution[i], 1, MPI_INT, i+1, 0, MPI_COMM_WORLD); // Start row
-                MPI_Send(&rows_distribution[i+1], 1, MPI_INT, i+1, 0, MPI_COMM_WORLD); // End row
+                int row_block = use_2d ? i / grid_q : i;
+                MPI_Send(&rows_distribution[row_block], 1, MPI_INT, i+1, 0, MPI_COMM_WORLD); // Start row
+                MPI_Send(&rows_distribution[row_block+1], 1, MPI_INT, i+1, 0, MPI_COMM_WORLD); // End row
+                if (use_2d) {
+                    int col_block = i % grid_q;
+                    MPI_Send(&rows_distribution[col_block], 1, MPI_INT, i+1, 0, MPI_COMM_WORLD); // Start column
+                    MPI_Send(&rows_distribution[col_block+1], 1, MPI_INT, i+1, 0, MPI_COMM_WORLD); // End column
+                }
             }
             t_end = MPI_Wtime();
             communication_time[iter] += (t_end - t_start);
             
 
-            /* Find local nz for all processes and distribute it */
-            int *local_nz = (int *) malloc(processes * sizeof(int));
-            if (!local_nz) {
-                fprintf(stderr, "Iteration: %d - Process %d failed to allocate memory for local nz\n", iter+1, rank);
-                fflush(stderr);
-                MPI_Abort(MPI_COMM_WORLD, 1);
-            }
-            for (int i = 0; i < processes; i++) {
-                local_nz[i] = 0;
-            }
+            /* Find local nz for all processes and send their part of the matrix (generated by themselves with --local-gen) */
+            nz_t *local_nz = NULL;
+            if (!local_gen) {
+                local_nz = (nz_t *) malloc(processes * sizeof(nz_t));
+                if (!local_nz) {
+                    fprintf(stderr, "Iteration: %d - Process %d failed to allocate memory for local nz\n", iter+1, rank);
+                    fflush(stderr);
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+                for (int i = 0; i < processes; i++) {
+                    local_nz[i] = 0;
+                }
             
-            for (int i = 0; i < nz; i++) { // "nz" assigned in generate_matrix
-                int row = I[i];
-                for (int p = 0; p < processes; p++) {
-                    if (row >= rows_distribution[p] && row < rows_distribution[p+1]) {
-                        local_nz[p]++;
-                        break;
+                for (nz_t i = 0; i < nz; i++) { // "nz" assigned in generate_matrix
+                    int p = find_block(rows_distribution, blocks, I[i]);
+                    if (use_2d) {
+                        p = p * grid_q + find_block(rows_distribution, blocks, J[i]);
                     }
+                    local_nz[p]++;
                 }
-            }
-            t_start = MPI_Wtime();
-            for (int i = 0; i < processes; i++) {
-                MPI_Send(&local_nz[i], 1, MPI_INT, i+1, 0, MPI_COMM_WORLD);
-            }
-            t_end = MPI_Wtime();
-            communication_time[iter] += (t_end - t_start);
-
-
-            /* Send the matrix in COO format */
-            t_start = MPI_Wtime();
-            printf("Iteration: %d - Process %d is sending the matrix in COO format to other processes.\n", iter+1, rank);
-            fflush(stdout);
-            for (int i = 0; i < nz; i++) {
-                int row = I[i];
-                // Determine which process the row belongs to
-                for (int p = 0; p < processes; p++) {
-                    if (row >= rows_distribution[p] && row < rows_distribution[p+1]) {
-                        MPI_Send(&I[i], 1, MPI_INT, p+1, 0, MPI_COMM_WORLD);
-                        MPI_Send(&J[i], 1, MPI_INT, p+1, 0, MPI_COMM_WORLD);
-                        MPI_Send(&vals[i], 1, MPI_DOUBLE, p+1, 0, MPI_COMM_WORLD);
-                        break;
+                t_start = MPI_Wtime();
+                for (int i = 0; i < processes; i++) {
+                    MPI_Send(&local_nz[i], 1, MPI_NZ, i+1, 0, MPI_COMM_WORLD);
+                }
+                t_end = MPI_Wtime();
+                communication_time[iter] += (t_end - t_start);
+
+
+                /* Send the matrix in COO format */
+                t_start = MPI_Wtime();
+                printf("Iteration: %d - Process %d is sending the matrix in COO format to other processes.\n", iter+1, rank);
+                fflush(stdout);
+                for (nz_t i = 0; i < nz; i++) {
+                    // Determine which process the row (and column, with --2d) belongs to
+                    int p = find_block(rows_distribution, blocks, I[i]);
+                    if (use_2d) {
+                        p = p * grid_q + find_block(rows_distribution, blocks, J[i]);
                     }
+                    MPI_Send(&I[i], 1, MPI_INT, p+1, 0, MPI_COMM_WORLD);
+                    MPI_Send(&J[i], 1, MPI_INT, p+1, 0, MPI_COMM_WORLD);
+                    MPI_Send(&vals[i], 1, MPI_DOUBLE, p+1, 0, MPI_COMM_WORLD);
                 }
+                t_end = MPI_Wtime();
+                communication_time[iter] += (t_end - t_start);
             }
-            t_end = MPI_Wtime();
-            communication_time[iter] += (t_end - t_start);
 
             
-            /* Create vector of size M */
-            vector = (double *) malloc(M * sizeof(double));
+            /* Create vector of size M (block of M x block_k vectors, row-major, with --spmm) */
+            vector = (double *) malloc((size_t) M * block_k * sizeof(double));
             if (!vector) {
                 fprintf(stderr, "Iteration: %d - Process %d failed to allocate memory for random vector\n", iter+1, rank);
                 fflush(stderr);
                 MPI_Abort(MPI_COMM_WORLD, 1);
             }
-            for (int i = 0; i < M; i++) {
+            for (int i = 0; i < M * block_k; i++) {
                 vector[i] = (rand() % 9) +1; // Initialize all elements to 1.0
             }
 
@@ -184,19 +374,40 @@ int main(int argc, char *argv[]) {
             t_start = MPI_Wtime();
             printf("Iteration: %d - Process %d is sending parts of the vector to other processes.\n", iter+1, rank);
             fflush(stdout);
-            for (int i = 0; i < processes; i++) {
-                MPI_Send(&M, 1, MPI_INT, i+1, // i+1 because rank 0 does not process rows
-                    0, MPI_COMM_WORLD);
-                MPI_Send(vector, M, MPI_DOUBLE, i+1, // i+1 because rank 0 does not process rows
-                    0, MPI_COMM_WORLD);
+            MPI_Bcast(&M, 1, MPI_INT, 0, MPI_COMM_WORLD);
+            for (int i = 0; use_2d && i < processes; i++) {
+                if (i / grid_q == i % grid_q) {
+                    // Only the diagonal processes get their part, they broadcast it along their grid column
+                    int col_block = i % grid_q;
+                    MPI_Send(&vector[rows_distribution[col_block]], rows_distribution[col_block+1] - rows_distribution[col_block],
+                        MPI_DOUBLE, i+1, 0, MPI_COMM_WORLD);
+                }
+            }
+            if (!use_2d && !use_node_shared && !distribute_vector(vector_dist, vector, M * block_k, VECTOR_CHUNK)) {
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            if (use_node_shared) {
+                // The vector goes once to each node leader, the other processes of a node read its copy
+                double *shared_vector;
+                if (!shared_vector_allocate(node_comm, M * block_k, &vector_win, &shared_vector)) {
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+                memcpy(shared_vector, vector, (size_t) M * block_k * sizeof(double));
+                shared_vector_bcast(leader_comm, vector_win, shared_vector, M * block_k);
+                if (iter == 0) {
+                    int nodes;
+                    MPI_Comm_size(leader_comm, &nodes);
+                    printf("Node-aware vector: %d node(s), broadcast to %d node leader(s) instead of sent to %d processes.\n", nodes, nodes - 1, processes);
+                    fflush(stdout);
+                }
             }
             t_end = MPI_Wtime();
             communication_time[iter] += (t_end - t_start);
 
 
             /* Allocate memory for results */
-            results = (double *) malloc(M * sizeof(double));
-            double *local_results = (double *) malloc(M * sizeof(double)); // Max size needed for rank 0
+            results = (double *) malloc((size_t) M * block_k * sizeof(double));
+            double *local_results = (double *) malloc((size_t) M * block_k * sizeof(double)); // Max size needed for rank 0
             if (!local_results || !results) {
                 fprintf(stderr, "Iteration: %d - Process %d failed to allocate memory for results\n", iter+1, rank);
                 fflush(stderr);
@@ -204,8 +415,8 @@ int main(int argc, char *argv[]) {
             }
             
 
-            /* Read the matrix into CSR format */
-            if (!coo_to_csr(nz, 0, M, I, J, vals, &row_ptr)) {
+            /* Read the matrix into CSR format (already generated in CSR with --local-gen) */
+            if (!local_gen && !coo_to_csr(nz, 0, M, I, J, vals, &row_ptr)) {
                 fprintf(stderr, "Iteration %d - Process %d failed converting the matrix to CSR\n", iter+1, rank);
                 fflush(stderr);
                 MPI_Abort(MPI_COMM_WORLD, 1);
@@ -224,6 +435,12 @@ int main(int argc, char *argv[]) {
             fflush(stdout);*/
 
 
+            // With --spmm the columns of the block are made contiguous before timing the reference
+            double *x_columns = NULL, *y_columns = NULL;
+            if (block_k > 1 && (!block_to_columns(M, block_k, vector, &x_columns) || !block_to_columns(M, block_k, NULL, &y_columns))) {
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+
             MPI_Barrier(MPI_COMM_WORLD);
             double local_start = MPI_Wtime();
             printf("Iteration: %d - Computation started.\n", iter+1);
@@ -231,28 +448,39 @@ int main(int argc, char *argv[]) {
 
 
             /* Compute the SpMV result */
-            SpMV_csr(M, row_ptr, J, vals, vector, local_results);
+            // With --spmm the reference does one SpMV per vector, as it would be done without SpMM
+            if (block_k > 1) {
+                SpMV_csr_columns(M, M, block_k, row_ptr, J, vals, x_columns, y_columns);
+            } else {
+                SpMV_csr(M, row_ptr, J, vals, vector, local_results);
+            }
             double local_end = MPI_Wtime();
             not_par_computation_time[iter] = local_end - local_start;
+            if (block_k > 1) {
+                columns_to_block(M, block_k, y_columns, local_results);
+                free(x_columns);
+                free(y_columns);
+            }
 
 
             /* Receive back results from all processes */
             t_start = MPI_Wtime();
 
-            int max_M = find_max_M(rows_distribution, processes);
-            double *temp_buffer = (double *) malloc(max_M * sizeof(double));
+            int max_M = find_max_M(rows_distribution, blocks);
+            double *temp_buffer = (double *) malloc((size_t) max_M * block_k * sizeof(double));
             if (!temp_buffer) {
                 fprintf(stderr, "Iteration: %d - Process %d failed to allocate memory for temp buffer while receiving back results\n", iter+1, rank);
                 fflush(stderr);
                 MPI_Abort(MPI_COMM_WORLD, 1);
             }
 
-            for (int i = 0; i < processes; i++) {
+            for (int i = 0; i < blocks; i++) {
                 int start_row = rows_distribution[i];
                 int local_M = rows_distribution[i+1] - start_row;
-                MPI_Recv(temp_buffer, local_M, MPI_DOUBLE, i+1, 0, MPI_COMM_WORLD, &status);
-                for (int j = 0; j < local_M; j++) {
-                    results[start_row + j] = temp_buffer[j];
+                int source = use_2d ? 1 + i * grid_q + i : i+1; // With --2d the grid row is reduced on its diagonal process
+                MPI_Recv(temp_buffer, local_M * block_k, MPI_DOUBLE, source, 0, MPI_COMM_WORLD, &status);
+                for (int j = 0; j < local_M * block_k; j++) {
+                    results[start_row * block_k + j] = temp_buffer[j];
                 }
             }
             
@@ -284,7 +512,12 @@ int main(int argc, char *argv[]) {
             /* Verify correctness */
             //printf("Process %d is checking results correctness:\n", rank);
             //fflush(stdout);
-            if (check_results(local_results, results, M)) {
+            if (float_mode) {
+                // Float storage cannot match the double result exactly, report the error instead
+                double max_abs, relative;
+                compute_error(local_results, results, M, &max_abs, &relative);
+                printf("\tIteration: %d - Mixed precision error against double: max absolute %e, relative %e.\n", iter+1, max_abs, relative);
+            } else if (check_results(local_results, results, M * block_k)) {
                 printf("\tIteration: %d - Results are correct for MPI parallelization.\n", iter+1);
             } else {
                 printf("\tIteration: %d - Results are NOT correct for MPI parallelization.\n", iter+1);
@@ -295,6 +528,12 @@ int main(int argc, char *argv[]) {
                 double proc_comp_time;
                 MPI_Recv(&proc_comp_time, 1, MPI_DOUBLE, i+1, 0, MPI_COMM_WORLD, &status);
                 computation_time[iter] += proc_comp_time;
+                if (use_2d) {
+                    // Broadcast and reduction inside the grid are communication done by the working processes
+                    double proc_comm_time;
+                    MPI_Recv(&proc_comm_time, 1, MPI_DOUBLE, i+1, 0, MPI_COMM_WORLD, &status);
+                    communication_time[iter] += proc_comm_time;
+                }
             }
 
             if (local_results) {
@@ -312,32 +551,60 @@ int main(int argc, char *argv[]) {
 
         } else {        
 
+            /* Receive the generator seed from rank 0 */
+            if (local_gen) {
+                MPI_Bcast(&seed, 1, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+            }
+
             /* Receive the rows distribution from rank 0 */
             int start_row, end_row, local_M;
             MPI_Recv(&start_row, 1, MPI_INT, 0, 0, MPI_COMM_WORLD, &status);
             MPI_Recv(&end_row, 1, MPI_INT, 0, 0, MPI_COMM_WORLD, &status);
             local_M = end_row - start_row;
+            int start_col = 0, local_N = M; // With --2d only a range of columns, and of the vector, is local
+            if (use_2d) {
+                int end_col;
+                MPI_Recv(&start_col, 1, MPI_INT, 0, 0, MPI_COMM_WORLD, &status);
+                MPI_Recv(&end_col, 1, MPI_INT, 0, 0, MPI_COMM_WORLD, &status);
+                local_N = end_col - start_col;
+            }
             /*printf("Process %d received rows %d to %d.\n", rank, start_row, end_row-1);
             printf("Process %d local_M: %d\n", rank, local_M);
             fflush(stdout);*/
 
 
-            /* Receive the part of the matrix in COO format */
-            // Receive nz
-            MPI_Recv(&nz, 1, MPI_INT, 0, 0, MPI_COMM_WORLD, &status);
-            I = (int *) malloc(nz * sizeof(int));
-            J = (int *) malloc(nz * sizeof(int));
-            vals = (double *) malloc(nz * sizeof(double));
-            if (!I || !J || !vals) {
-                fprintf(stderr, "Process %d failed to allocate memory for COO matrix part\n", rank);
-                fflush(stderr);
-                MPI_Abort(MPI_COMM_WORLD, 1);
-            }
+            /* Generate the local part of the matrix directly in CSR, or receive it */
+            if (local_gen) {
+                double gen_start = MPI_Wtime();
+                int end_col = use_2d ? start_col + local_N : N;
+                if (!generate_family_rows(family, seed, M, N, start_row, end_row, start_col, end_col, percent_nonzero, &row_ptr, &J, &vals, &nz)) {
+                    fprintf(stderr, "Process %d failed to generate its part of the matrix\n", rank);
+                    fflush(stderr);
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+                if (iter == 0) {
+                    printf("Process %d generated its %d rows (%ld non-zeros) in %f seconds\n", rank, local_M, (long) nz, MPI_Wtime() - gen_start);
+                    fflush(stdout);
+                }
+            } else {
+                /* Receive the part of the matrix in COO format */
+                // Receive nz
+                MPI_Recv(&nz, 1, MPI_NZ, 0, 0, MPI_COMM_WORLD, &status);
+                I = (int *) malloc(nz * sizeof(int));
+                J = (int *) malloc(nz * sizeof(int));
+                vals = (double *) malloc(nz * sizeof(double));
+                if (!I || !J || !vals) {
+                    fprintf(stderr, "Process %d failed to allocate memory for COO matrix part\n", rank);
+                    fflush(stderr);
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
 
-            for (int i=0; i<nz; i++) {
-                MPI_Recv(&I[i], 1, MPI_INT, 0, 0, MPI_COMM_WORLD, &status);
-                MPI_Recv(&J[i], 1, MPI_INT, 0, 0, MPI_COMM_WORLD, &status);
-                MPI_Recv(&vals[i], 1, MPI_DOUBLE, 0, 0, MPI_COMM_WORLD, &status);
+                for (nz_t i=0; i<nz; i++) {
+                    MPI_Recv(&I[i], 1, MPI_INT, 0, 0, MPI_COMM_WORLD, &status);
+                    MPI_Recv(&J[i], 1, MPI_INT, 0, 0, MPI_COMM_WORLD, &status);
+                    MPI_Recv(&vals[i], 1, MPI_DOUBLE, 0, 0, MPI_COMM_WORLD, &status);
+                    J[i] -= start_col; // Local column, to index the local part of the vector
+                }
             }
 
             /*for (int i=0; i<nz; i++) {
@@ -347,14 +614,38 @@ int main(int argc, char *argv[]) {
             
 
             /* Receive the vector from rank 0 */
-            MPI_Recv(&M, 1, MPI_INT, 0, 0, MPI_COMM_WORLD, &status);
-            vector = (double *) malloc(M * sizeof(double));
-            if (!vector) {
-                fprintf(stderr, "Process %d failed to allocate memory for vector\n", rank);
-                fflush(stderr);
-                MPI_Abort(MPI_COMM_WORLD, 1);
+            MPI_Bcast(&M, 1, MPI_INT, 0, MPI_COMM_WORLD);
+            if (!use_2d) {
+                local_N = M;
+            }
+            double grid_comm_time = 0.0; // Time spent communicating inside the grid, with --2d
+            if (use_node_shared) {
+                // Read the copy of the node leader, which gets it from rank 0
+                if (!shared_vector_allocate(node_comm, M * block_k, &vector_win, &vector)) {
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+                shared_vector_bcast(leader_comm, vector_win, vector, M * block_k);
+            } else {
+                vector = (double *) malloc((size_t) local_N * block_k * sizeof(double));
+                if (!vector) {
+                    fprintf(stderr, "Process %d failed to allocate memory for vector\n", rank);
+                    fflush(stderr);
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+                if (!use_2d) {
+                    if (!distribute_vector(vector_dist, vector, M * block_k, VECTOR_CHUNK)) {
+                        MPI_Abort(MPI_COMM_WORLD, 1);
+                    }
+                } else {
+                    if (grid_row == grid_col) {
+                        MPI_Recv(vector, local_N, MPI_DOUBLE, 0, 0, MPI_COMM_WORLD, &status);
+                    }
+                    t_start = MPI_Wtime();
+                    MPI_Bcast(vector, local_N, MPI_DOUBLE, grid_col, col_comm); // The diagonal process has rank grid_col in the column
+                    t_end = MPI_Wtime();
+                    grid_comm_time += (t_end - t_start);
+                }
             }
-            MPI_Recv(vector, M, MPI_DOUBLE, 0, 0, MPI_COMM_WORLD, &status);
 
             /* Print received vector */
             /*printf("Process %d received vector:\n", rank);
@@ -365,7 +656,7 @@ int main(int argc, char *argv[]) {
 
 
             /* Allocate memory for result vector to fill */
-            results = (double *) malloc(local_M * sizeof(double));
+            results = (double *) malloc((size_t) local_M * block_k * sizeof(double));
             if (!results) {
                 fprintf(stderr, "Process %d failed to allocate memory for results vector\n", rank);
                 fflush(stderr);
@@ -375,8 +666,8 @@ int main(int argc, char *argv[]) {
 
             /*printf("Rank: %d - nz: %d\n", rank, nz);
             fflush(stdout);*/
-            /* Read the matrix into CSR format */
-            if (!coo_to_csr(nz, start_row, local_M, I, J, vals, &row_ptr)) {
+            /* Read the matrix into CSR format (already generated in CSR with --local-gen) */
+            if (!local_gen && !coo_to_csr(nz, start_row, local_M, I, J, vals, &row_ptr)) {
                 fprintf(stderr, "Process %d failed converting the matrix to CSR\n", rank);
                 fflush(stderr);
                 MPI_Abort(MPI_COMM_WORLD, 1);
@@ -393,7 +684,94 @@ int main(int argc, char *argv[]) {
             }
             fflush(stdout);*/
 
+
+            /* Compress the column indices if requested */
+            if (use_csr_du) {
+                if (!csr_to_csr_du(local_M, row_ptr, J, vals, &du_ctl, &du_ctl_size)) {
+                    fprintf(stderr, "Process %d failed converting its part of the matrix to CSR-DU\n", rank);
+                    fflush(stderr);
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+                if (iter == 0) {
+                    // Index bytes read by the kernels: CSR streams row_ptr and the column indices, CSR-DU only the ctl stream
+                    printf("Process %d CSR-DU index bytes: %ld instead of %ld\n", rank,
+                           (long) du_ctl_size, (long) ((local_M + 1) * sizeof(nz_t) + nz * sizeof(int)));
+                    fflush(stdout);
+                }
+            }
+
+            /* Cut the local rows in square blocks if requested */
+            if (use_csb) {
+                int csb_N = use_2d ? local_N : N; // Columns of the local part, local with --2d
+                if (!csb_beta) {
+                    csb_beta = csb_default_beta(local_M, csb_N);
+                }
+                if (!csr_to_csb(local_M, csb_N, row_ptr, J, vals, csb_beta, &csb_blk_ptr, &csb_row, &csb_col, &csb_vals)) {
+                    fprintf(stderr, "Process %d failed converting its part of the matrix to CSB\n", rank);
+                    fflush(stderr);
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+                if (iter == 0) {
+                    // Index bytes: CSR has a pointer per row and a 32 bit column per non-zero, CSB a pointer per block and two 16 bit indices
+                    long blocks = ((long) local_M + csb_beta - 1) / csb_beta * (((long) csb_N + csb_beta - 1) / csb_beta);
+                    printf("Process %d CSB indices (beta %d, %ld blocks): %ld bytes instead of %ld\n", rank, csb_beta, blocks,
+                           (blocks + 1) * (long) sizeof(nz_t) + (long) nz * 2 * sizeof(uint16_t),
+                           ((long) local_M + 1) * (long) sizeof(nz_t) + (long) nz * sizeof(int));
+                    fflush(stdout);
+                }
+            }
+
+            /* Replace the values with a dictionary if requested, when there are few distinct values */
+            if (use_vi) {
+                int distinct = count_distinct_values(nz, vals, VI_MAX_DICT);
+                if (csr_vi_is_worth(nz, distinct)) {
+                    if (!csr_to_csr_vi(nz, vals, &vi_dict, &vi_dict_size, &vi_codes, &vi_code_bytes)) {
+                        fprintf(stderr, "Process %d failed building the value dictionary\n", rank);
+                        fflush(stderr);
+                        MPI_Abort(MPI_COMM_WORLD, 1);
+                    }
+                    free(vals); // Not needed anymore, the codes replace them
+                    vals = NULL;
+                }
+                if (iter == 0) {
+                    if (vi_codes) {
+                        printf("Process %d value dictionary: %d distinct values, %d bit codes\n", rank, vi_dict_size, vi_code_bytes * 8);
+                    } else {
+                        printf("Process %d value dictionary: too many distinct values, keeping CSR\n", rank);
+                    }
+                    fflush(stdout);
+                }
+            }
+
+            /* Store values (and vector) in float if requested */
+            if (float_mode) {
+                if (!double_to_float(nz, vals, &vals_f)) {
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+                free(vals); // Not needed anymore, vals_f replaces them
+                vals = NULL;
+                if (float_mode == 2 && !double_to_float(local_N, vector, &vector_f)) {
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+            }
+
             
+            /* Keep only the non-empty rows if most of the local rows are empty */
+            if (use_dcsr && block_k == 1 && !du_ctl && !vi_codes && !vals_f && !csb_blk_ptr) {
+                dcsr_rows = count_nonempty_rows(local_M, row_ptr);
+                if (dcsr_is_worth(local_M, dcsr_rows)) {
+                    if (!csr_to_dcsr(local_M, row_ptr, dcsr_rows, &dcsr_row_ids, &dcsr_ptr)) {
+                        fprintf(stderr, "Process %d failed converting its part of the matrix to DCSR\n", rank);
+                        fflush(stderr);
+                        MPI_Abort(MPI_COMM_WORLD, 1);
+                    }
+                    if (iter == 0) {
+                        printf("Process %d DCSR: %d non-empty rows of %d\n", rank, dcsr_rows, local_M);
+                        fflush(stdout);
+                    }
+                }
+            }
+
             // Wait for all processes to be ready, then start timing
             MPI_Barrier(MPI_COMM_WORLD);
 
@@ -401,7 +779,25 @@ int main(int argc, char *argv[]) {
             t_start = MPI_Wtime();
             //printf("Process %d is computing its SpMV part.\n", rank);
             //fflush(stdout);
-            SpMV_csr(local_M, row_ptr, J, vals, vector, results);
+            if (block_k > 1) {
+                SpMM_csr(local_M, block_k, row_ptr, J, vals, vector, results);
+            } else if (du_ctl) {
+                SpMV_csr_du(du_ctl, du_ctl_size, vals, vector, results);
+            } else if (csb_blk_ptr) {
+                SpMV_csb(local_M, use_2d ? local_N : N, csb_beta, csb_blk_ptr, csb_row, csb_col, csb_vals, vector, results);
+            } else if (vi_codes && vi_code_bytes == 1) {
+                SpMV_csr_vi8(local_M, row_ptr, J, vi_dict, (uint8_t *) vi_codes, vector, results);
+            } else if (vi_codes) {
+                SpMV_csr_vi16(local_M, row_ptr, J, vi_dict, (uint16_t *) vi_codes, vector, results);
+            } else if (vector_f) {
+                SpMV_csr_float_x(local_M, row_ptr, J, vals_f, vector_f, results);
+            } else if (vals_f) {
+                SpMV_csr_float(local_M, row_ptr, J, vals_f, vector, results);
+            } else if (dcsr_row_ids) {
+                SpMV_dcsr(local_M, dcsr_rows, dcsr_row_ids, dcsr_ptr, J, vals, vector, results);
+            } else {
+                SpMV_csr(local_M, row_ptr, J, vals, vector, results);
+            }
 
             /* Print result vector */
             //printf("Process %d results:\n", rank);
@@ -414,10 +810,24 @@ int main(int argc, char *argv[]) {
             double local_comp_time = t_end - t_start;
 
             /* Send back results to rank 0 */
-            MPI_Send(results, local_M, MPI_DOUBLE, 0, 0, MPI_COMM_WORLD);
+            if (!use_2d) {
+                MPI_Send(results, local_M * block_k, MPI_DOUBLE, 0, 0, MPI_COMM_WORLD);
+            } else {
+                // Sum the partial results of the grid row on the diagonal process, which sends them
+                t_start = MPI_Wtime();
+                MPI_Reduce(grid_row == grid_col ? MPI_IN_PLACE : results, results, local_M, MPI_DOUBLE, MPI_SUM, grid_row, row_comm);
+                if (grid_row == grid_col) {
+                    MPI_Send(results, local_M, MPI_DOUBLE, 0, 0, MPI_COMM_WORLD);
+                }
+                t_end = MPI_Wtime();
+                grid_comm_time += (t_end - t_start);
+            }
 
             /* Send computation time to rank 0 */
             MPI_Send(&local_comp_time, 1, MPI_DOUBLE, 0, 0, MPI_COMM_WORLD);
+            if (use_2d) {
+                MPI_Send(&grid_comm_time, 1, MPI_DOUBLE, 0, 0, MPI_COMM_WORLD);
+            }
 
             // Barrier to ensure all processes finish before checking results
             MPI_Barrier(MPI_COMM_WORLD);
@@ -442,6 +852,12 @@ int main(int argc, char *argv[]) {
             free(vals);
             vals = NULL;
         }
+        if (vector_win != MPI_WIN_NULL) {
+            if (rank != 0) {
+                vector = NULL; // It is the copy of the node leader, freed with the window
+            }
+            MPI_Win_free(&vector_win);
+        }
         if (vector) {
             free(vector);
             vector = NULL;
@@ -450,6 +866,42 @@ int main(int argc, char *argv[]) {
             free(results);
             results = NULL;
         }
+        if (du_ctl) {
+            free(du_ctl);
+            du_ctl = NULL;
+        }
+        if (dcsr_row_ids) {
+            free(dcsr_row_ids);
+            free(dcsr_ptr);
+            dcsr_row_ids = NULL;
+            dcsr_ptr = NULL;
+        }
+        if (csb_blk_ptr) {
+            free(csb_blk_ptr);
+            free(csb_row);
+            free(csb_col);
+            free(csb_vals);
+            csb_blk_ptr = NULL;
+            csb_row = NULL;
+            csb_col = NULL;
+            csb_vals = NULL;
+        }
+        if (vi_dict) {
+            free(vi_dict);
+            vi_dict = NULL;
+        }
+        if (vi_codes) {
+            free(vi_codes);
+            vi_codes = NULL;
+        }
+        if (vals_f) {
+            free(vals_f);
+            vals_f = NULL;
+        }
+        if (vector_f) {
+            free(vector_f);
+            vector_f = NULL;
+        }
 
         // Barrier to synchronize before next iteration
         MPI_Barrier(MPI_COMM_WORLD);
@@ -494,7 +946,7 @@ int main(int argc, char *argv[]) {
             fflush(stderr);
             return false;
         }
-        fprintf(f, "#Matrix: %s - Row: %d - Columns: %d - Processes: %d\n", "9%% scarsity", M, N, processes);
+        fprintf(f, "#Matrix: %s %d%% - Row: %d - Columns: %d - Processes: %d\n", matrix_family_name(family), percent_nonzero, M, N, processes);
         fprintf(f, "avg_comp_time: %f\n", avg_comp_time);
         fprintf(f, "avg_comm_time: %f\n", avg_comm_time);
         fprintf(f, "avg_total_time: %f\n", avg_total_time);
@@ -509,6 +961,18 @@ int main(int argc, char *argv[]) {
     free(computation_time);
     free(communication_time);
     free(not_par_computation_time);
+    if (node_comm != MPI_COMM_NULL) {
+        MPI_Comm_free(&node_comm);
+    }
+    if (leader_comm != MPI_COMM_NULL) {
+        MPI_Comm_free(&leader_comm);
+    }
+    if (row_comm != MPI_COMM_NULL) {
+        MPI_Comm_free(&row_comm);
+    }
+    if (col_comm != MPI_COMM_NULL) {
+        MPI_Comm_free(&col_comm);
+    }
     
 
     MPI_Finalize();
@@ -2,9 +2,21 @@
 #include <stdlib.h>
 #include <time.h>
 #include <string.h>
+#include <limits.h>
 #include "libraries/SpMV.h"
 #include "libraries/data_management.h"
 #include "libraries/matrix_reading.h"
+#include "libraries/csr_du.h"
+#include "libraries/csr_vi.h"
+#include "libraries/csb.h"
+#include "libraries/dcsr.h"
+#include "libraries/reordering.h"
+#include "libraries/partitioning.h"
+#include "libraries/rebalancing.h"
+#include "libraries/shared_vector.h"
+#include "libraries/csr_cache.h"
+#include "libraries/streaming.h"
+#include "libraries/vector_distribution.h"
 #include <mpi.h>
 
 int main(int argc, char *argv[]) {
@@ -13,11 +25,29 @@ int main(int argc, char *argv[]) {
     char filename[256] = "";
     char result_filename[256] = "";
 
-    int *J= NULL, *row_ptr = NULL; // Initialize pointers to avoid problems with free()
+    nz_t *row_ptr = NULL; // Initialize pointers to avoid problems with free()
+    int *J= NULL;
     double *vals = NULL, *vector = NULL, *results = NULL;
+    uint8_t *du_ctl = NULL; // CSR-DU stream, used with --csr-du
+    nz_t du_ctl_size = 0;
+    nz_t *csb_blk_ptr = NULL; // CSB arrays, used with --csb
+    uint16_t *csb_row = NULL, *csb_col = NULL;
+    double *csb_vals = NULL;
+    int *dcsr_row_ids = NULL; // DCSR non-empty rows, used when most of the local rows are empty
+    nz_t *dcsr_ptr = NULL;
+    int dcsr_rows = 0;
+    double *vi_dict = NULL; // Value dictionary and codes, used with --vi
+    void *vi_codes = NULL;
+    int vi_dict_size = 0, vi_code_bytes = 0;
+    float *vals_f = NULL, *vector_f = NULL; // Float copies, used with --float and --float-x
+    int *perm = NULL, *iperm = NULL; // Reordering permutation (new -> old) and its inverse, used with --reorder and --partition
+    int *part = NULL, *part_rows = NULL; // Part of each row and rows of each part, used with --partition
     int M; // Number of rows
     int N; // Number of columns
-    int nz; // Total number of non-zero entries
+    nz_t nz; // Total number of non-zero entries
+    MM_typecode matcode; // Matrix Market type of the file
+    int symmetric = 0; // Symmetric matrices are kept in symmetric storage by the working processes
+    int pattern = 0; // Pattern matrices are kept without values by the working processes
     //srand(42); // For debugging purposes
     srand(time(NULL));
 
@@ -37,15 +67,194 @@ int main(int argc, char *argv[]) {
     }
 
     /* Check the right amount of argument and open the file */
-    if (argc != 4) {
+    if (argc < 4) {
         if (rank == 0) {
-            fprintf(stderr, "Intended usage: %s [martix-market-filename] [number-of-threads]\n", argv[0]);
+            fprintf(stderr, "Intended usage: %s [matrix-market-filename] [iterations] [plot-result-file] [options]\n", argv[0]);
+            fprintf(stderr, "Options: --csr-du, --vi, --float, --float-x, --spmm [k], --reorder [rcm|degree], --partition, --adaptive [n], --node-shared, --mmap-cache [populate],\n");
+            fprintf(stderr, "         --vector-dist [send|bcast|scatter|pipeline], --stream-reference [chunk-MB], --transpose, --csb [beta], --no-dcsr\n");
             fflush(stderr);
         }
         MPI_Finalize();
         exit(1);
     }
 
+    /* Optional flags, after the required arguments */
+    bool use_csr_du = false; // Compressed column indices for the working processes
+    bool use_vi = false; // Value dictionary for the working processes, when there are few distinct values
+    int float_mode = 0; // 1: values stored in float, 2: values and vector stored in float
+    int block_k = 1; // Number of vectors multiplied at once (SpMM), 1 is the plain SpMV
+    int reorder = 0; // 1: Reverse Cuthill-McKee, 2: rows sorted by degree
+    bool use_partition = false; // Rows assigned to the processes by the graph partitioner
+    int adaptive_products = 0; // Products timed before and after rebalancing the rows, 0 disables it
+    bool use_node_shared = false; // One copy of the vector per node, in a shared memory window
+    int vector_dist = VECTOR_BCAST; // How rank 0 distributes the vector (see vector_distribution.h)
+    bool use_cache = false; // Matrix mapped from a binary CSR cache instead of parsed by every process
+    bool populate_cache = false; // Read the whole cache in when mapping it
+    long stream_chunk = 0; // Bytes per block read by rank 0 streaming the reference from the cache, 0 disables it
+    bool use_transpose = false; // y = A^T x on the CSR of A, the partial results of the working processes are reduced
+    bool use_csb = false; // Square blocks with 16 bit in-block indices for the working processes
+    int csb_beta = 0; // Block size of --csb, 0 picks it from the size of the local part
+    bool use_dcsr = true; // Only the non-empty local rows when most are empty, disabled by --no-dcsr
+    for (int a = 4; a < argc; a++) {
+        if (strcmp(argv[a], "--csr-du") == 0) {
+            use_csr_du = true;
+        } else if (strcmp(argv[a], "--vi") == 0) {
+            use_vi = true;
+        } else if (strcmp(argv[a], "--float") == 0) {
+            float_mode = 1;
+        } else if (strcmp(argv[a], "--float-x") == 0) {
+            float_mode = 2;
+        } else if (strcmp(argv[a], "--reorder") == 0 && a + 1 < argc && strcmp(argv[a+1], "rcm") == 0) {
+            reorder = 1;
+            a++;
+        } else if (strcmp(argv[a], "--reorder") == 0 && a + 1 < argc && strcmp(argv[a+1], "degree") == 0) {
+            reorder = 2;
+            a++;
+        } else if (strcmp(argv[a], "--partition") == 0) {
+            use_partition = true;
+        } else if (strcmp(argv[a], "--adaptive") == 0 && a + 1 < argc) {
+            adaptive_products = atoi(argv[++a]);
+            if (adaptive_products < 1) {
+                if (rank == 0) {
+                    fprintf(stderr, "The number of adaptive products must be at least 1\n");
+                    fflush(stderr);
+                }
+                MPI_Finalize();
+                exit(1);
+            }
+        } else if (strcmp(argv[a], "--mmap-cache") == 0) {
+            use_cache = true;
+            if (a + 1 < argc && strcmp(argv[a+1], "populate") == 0) {
+                populate_cache = true;
+                a++;
+            }
+        } else if (strcmp(argv[a], "--stream-reference") == 0) {
+            stream_chunk = (long) STREAM_CHUNK_MB << 20;
+            if (a + 1 < argc && atol(argv[a+1]) > 0) {
+                stream_chunk = atol(argv[++a]) << 20;
+            }
+        } else if (strcmp(argv[a], "--vector-dist") == 0 && a + 1 < argc && parse_vector_distribution(argv[a+1], &vector_dist)) {
+            a++;
+        } else if (strcmp(argv[a], "--node-shared") == 0) {
+            use_node_shared = true;
+        } else if (strcmp(argv[a], "--transpose") == 0) {
+            use_transpose = true;
+        } else if (strcmp(argv[a], "--no-dcsr") == 0) {
+            use_dcsr = false;
+        } else if (strcmp(argv[a], "--csb") == 0) {
+            use_csb = true;
+            if (a + 1 < argc && atoi(argv[a+1]) > 0) {
+                csb_beta = atoi(argv[++a]);
+                if (csb_beta > CSB_MAX_BETA) {
+                    if (rank == 0) {
+                        fprintf(stderr, "The CSB block size can be at most %d\n", CSB_MAX_BETA);
+                        fflush(stderr);
+                    }
+                    MPI_Finalize();
+                    exit(1);
+                }
+            }
+        } else if (strcmp(argv[a], "--spmm") == 0 && a + 1 < argc) {
+            block_k = atoi(argv[++a]);
+            if (block_k < 1) {
+                if (rank == 0) {
+                    fprintf(stderr, "The SpMM block size must be at least 1\n");
+                    fflush(stderr);
+                }
+                MPI_Finalize();
+                exit(1);
+            }
+        } else {
+            if (rank == 0) {
+                fprintf(stderr, "Unknown option: %s\n", argv[a]);
+                fflush(stderr);
+            }
+            MPI_Finalize();
+            exit(1);
+        }
+    }
+    if (use_csr_du + use_vi + use_csb + (float_mode > 0) + (block_k > 1) > 1) {
+        if (rank == 0) {
+            fprintf(stderr, "Options --csr-du, --vi, --csb, --float(-x) and --spmm cannot be combined\n");
+            fflush(stderr);
+        }
+        MPI_Finalize();
+        exit(1);
+    }
+    if (adaptive_products && (use_csr_du || use_vi || use_csb || float_mode || block_k > 1)) {
+        if (rank == 0) {
+            fprintf(stderr, "Option --adaptive cannot be combined with --csr-du, --vi, --csb, --float(-x) and --spmm\n");
+            fflush(stderr);
+        }
+        MPI_Finalize();
+        exit(1);
+    }
+    if (reorder && use_partition) {
+        if (rank == 0) {
+            fprintf(stderr, "Options --reorder and --partition cannot be combined\n");
+            fflush(stderr);
+        }
+        MPI_Finalize();
+        exit(1);
+    }
+    // Both are applied as a permutation of rows and columns, the partition groups the rows by process
+    bool permuted = reorder || use_partition;
+    if (use_cache && (use_csr_du || use_vi || use_csb || float_mode || permuted || adaptive_products)) {
+        // The mapped matrix is read-only and in the original order
+        if (rank == 0) {
+            fprintf(stderr, "Option --mmap-cache can be combined only with --spmm, --node-shared and --transpose\n");
+            fflush(stderr);
+        }
+        MPI_Finalize();
+        exit(1);
+    }
+    if (stream_chunk && (permuted || block_k > 1)) {
+        // The permutations need the whole matrix on rank 0 anyway, the SpMM reference one product per vector
+        if (rank == 0) {
+            fprintf(stderr, "Option --stream-reference cannot be combined with --reorder, --partition and --spmm\n");
+            fflush(stderr);
+        }
+        MPI_Finalize();
+        exit(1);
+    }
+    if (use_transpose && (use_csr_du || use_vi || float_mode || block_k > 1 || adaptive_products || stream_chunk)) {
+        // Only the plain and pattern kernels have a transposed version
+        if (rank == 0) {
+            fprintf(stderr, "Option --transpose cannot be combined with --csr-du, --vi, --float(-x), --spmm, --adaptive and --stream-reference\n");
+            fflush(stderr);
+        }
+        MPI_Finalize();
+        exit(1);
+    }
+    if (permuted) {
+        // The same permutation is applied to rows and columns, which is meaningless for a rectangular matrix
+        int square = 0;
+        if (rank == 0) {
+            int check_M, check_N;
+            nz_t check_nz;
+            square = check_matrix_file(argv[1], &check_M, &check_N, &check_nz, matcode) && check_M == check_N;
+            if (!square) {
+                fprintf(stderr, "Options --reorder and --partition need a square matrix\n");
+                fflush(stderr);
+            }
+        }
+        MPI_Bcast(&square, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        if (!square) {
+            MPI_Finalize();
+            exit(1);
+        }
+    }
+    char cache_name[300] = ""; // Binary CSR cache next to the matrix file, with --mmap-cache and --stream-reference
+    void *cache_map = NULL;
+    size_t cache_map_size = 0;
+
+    /* Node communicators for the shared vector */
+    MPI_Comm node_comm = MPI_COMM_NULL, leader_comm = MPI_COMM_NULL;
+    MPI_Win vector_win = MPI_WIN_NULL; // Window holding the vector of the node, with --node-shared
+    if (use_node_shared) {
+        node_comms_create(rank, &node_comm, &leader_comm);
+    }
+
     snprintf(result_filename, sizeof(result_filename), "%s", argv[3]); // File to store results
 
     num_iterations = atoi(argv[2]); // Number of times to repeat the sending process for averaging
@@ -55,7 +264,9 @@ int main(int argc, char *argv[]) {
     double *computation_time = malloc(num_iterations * sizeof(double));
     double *communication_time = malloc(num_iterations * sizeof(double));
     double *not_par_computation_time = malloc(num_iterations * sizeof(double));
-    if (!computation_time || !communication_time || !not_par_computation_time) {
+    double *transpose_build_time = malloc(num_iterations * sizeof(double)); // Explicit A^T on rank 0, with --transpose
+    double *explicit_transpose_time = malloc(num_iterations * sizeof(double));
+    if (!computation_time || !communication_time || !not_par_computation_time || !transpose_build_time || !explicit_transpose_time) {
         fprintf(stderr, "Process %d failed to allocate memory for timing arrays\n", rank);
         fflush(stderr);
         MPI_Abort(MPI_COMM_WORLD, 1);
@@ -64,7 +275,10 @@ int main(int argc, char *argv[]) {
         computation_time[i] = 0.0;
         communication_time[i] = 0.0;
         not_par_computation_time[i] = 0.0;
+        transpose_build_time[i] = 0.0;
+        explicit_transpose_time[i] = 0.0;
     }
+    bool transposed = false; // With --transpose, unless A^T = A (symmetric storage)
     
 
     for (int iter = 0; iter < num_iterations; iter++) {
@@ -75,15 +289,141 @@ int main(int argc, char *argv[]) {
             /* Initial checks on the matrix */
             printf("Iteration: %d - Process %d is checking the matrix: %s\n", iter+1, rank, filename);
             fflush(stdout);
-            if (!check_matrix_file(filename, &M, &N, &nz)) {
+            if (!check_matrix_file(filename, &M, &N, &nz, matcode)) {
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            if (mm_is_complex(matcode)) {
+                fprintf(stderr, "Complex matrices are multiplied by execute_mpi_complex.c (del2_c)\n");
+                fflush(stderr);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            symmetric = mm_is_symmetric(matcode);
+            pattern = mm_is_pattern(matcode);
+            if (block_k > 1 && (symmetric || pattern)) {
+                fprintf(stderr, "Option --spmm supports only general real matrices\n");
+                fflush(stderr);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            if ((long long) (M > N ? M : N) * block_k > INT_MAX) {
+                // The blocks are indexed and counted with int, by the loops and in the MPI calls
+                fprintf(stderr, "The block of %d vectors of %d entries is too large\n", block_k, M > N ? M : N);
+                fflush(stderr);
                 MPI_Abort(MPI_COMM_WORLD, 1);
             }
+            transposed = use_transpose && !symmetric;
+            if (use_transpose && symmetric && iter == 0) {
+                printf("The matrix is symmetric, A^T x = A x is computed with the symmetric storage.\n");
+                fflush(stdout);
+            }
+
+            /* Write the binary cache if it is missing or older than the matrix file */
+            if (use_cache || stream_chunk) {
+                snprintf(cache_name, sizeof(cache_name), "%s.csr", filename);
+                if (!csr_cache_is_fresh(filename, cache_name)) {
+                    nz_t cache_nz;
+                    printf("Iteration: %d - Process %d is writing the binary cache: %s\n", iter+1, rank, cache_name);
+                    fflush(stdout);
+                    // Whole matrix in the storage of the working processes
+                    if (!read_matrix_to_csr_partial(filename, 0, M, matcode, NULL, &cache_nz, &row_ptr, &J, &vals)
+                        || !write_csr_cache(cache_name, M, N, cache_nz, row_ptr, J, vals)) {
+                        MPI_Abort(MPI_COMM_WORLD, 1);
+                    }
+                    free(row_ptr);
+                    free(J);
+                    if (vals) {
+                        free(vals);
+                    }
+                    row_ptr = NULL;
+                    J = NULL;
+                    vals = NULL;
+                }
+            }
+
+            /* Compute the reordering on the whole matrix, the working processes read the reordered rows */
+            if (permuted) {
+                if (!read_matrix_to_csr_total(filename, &row_ptr, &J, &vals)) {
+                    fprintf(stderr, "Process 0 failed reading the whole matrix: %s\n", filename);
+                    fflush(stderr);
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+                perm = (int *) malloc(M * sizeof(int));
+                iperm = (int *) malloc(M * sizeof(int));
+                if (!perm || !iperm) {
+                    fprintf(stderr, "Iteration: %d - Process %d failed to allocate memory for the reordering\n", iter+1, rank);
+                    fflush(stderr);
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+                bool ordered;
+                if (use_partition) {
+                    // Partition in as many parts as working processes, with nnz balanced within PARTITION_IMBALANCE
+                    part = (int *) malloc(M * sizeof(int));
+                    part_rows = (int *) malloc(processes * sizeof(int));
+                    if (!part || !part_rows) {
+                        fprintf(stderr, "Iteration: %d - Process %d failed to allocate memory for the partition\n", iter+1, rank);
+                        fflush(stderr);
+                        MPI_Abort(MPI_COMM_WORLD, 1);
+                    }
+                    ordered = partition_graph(M, row_ptr, J, processes, PARTITION_IMBALANCE, part)
+                              && partition_to_permutation(M, part, processes, perm, part_rows);
+                } else if (reorder == 1) {
+                    ordered = rcm_ordering(M, row_ptr, J, perm);
+                } else {
+                    ordered = degree_ordering(M, row_ptr, J, perm);
+                }
+                if (!ordered) {
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+                invert_permutation(M, perm, iperm);
+
+                if (iter == 0 && use_partition) {
+                    // Compare with the contiguous blocks of rows used without the partitioner
+                    int *block_part = (int *) malloc(M * sizeof(int));
+                    if (block_part) {
+                        for (int p = 0, row = 0; p < processes; p++) {
+                            int rows = M / processes + (p < M % processes ? 1 : 0);
+                            for (int r = 0; r < rows; r++) {
+                                block_part[row++] = p;
+                            }
+                        }
+                        // Imbalance: max nnz of a part over the average
+                        long max_nnz = 0;
+                        for (int p = 0, row = 0; p < processes; p++) {
+                            long part_nnz = 0;
+                            for (int r = 0; r < part_rows[p]; r++, row++) {
+                                part_nnz += row_ptr[perm[row]+1] - row_ptr[perm[row]];
+                            }
+                            if (part_nnz > max_nnz) {
+                                max_nnz = part_nnz;
+                            }
+                        }
+                        double nnz_imbalance = (double) max_nnz * processes / row_ptr[M];
+                        printf("Partition: cut non-zeros %ld -> %ld, halo volume %ld -> %ld, nnz imbalance %.3f (bound %.3f %s)\n",
+                               cut_nonzeros(M, row_ptr, J, block_part), cut_nonzeros(M, row_ptr, J, part),
+                               halo_volume(M, row_ptr, J, block_part, processes), halo_volume(M, row_ptr, J, part, processes),
+                               nnz_imbalance, 1.0 + PARTITION_IMBALANCE, nnz_imbalance <= 1.0 + PARTITION_IMBALANCE ? "met" : "NOT met");
+                        fflush(stdout);
+                        free(block_part);
+                    }
+                } else if (iter == 0) {
+                    long bandwidth_before, profile_before, bandwidth_after, profile_after;
+                    bandwidth_profile(M, row_ptr, J, NULL, &bandwidth_before, &profile_before);
+                    bandwidth_profile(M, row_ptr, J, iperm, &bandwidth_after, &profile_after);
+                    printf("Reordering (%s): bandwidth %ld -> %ld, profile %ld -> %ld\n", (reorder == 1) ? "RCM" : "degree",
+                           bandwidth_before, bandwidth_after, profile_before, profile_after);
+                    fflush(stdout);
+                }
+            }
 
             /* Give the filename to other processes */
             t_start = MPI_Wtime();
             printf("Iteration: %d - Process %d is broadcasting the filename to other processes.\n", iter+1, rank);
             fflush(stdout);
             MPI_Bcast(&filename, 256, MPI_CHAR, 0, MPI_COMM_WORLD);
+            MPI_Bcast(matcode, 4, MPI_CHAR, 0, MPI_COMM_WORLD);
+            if (permuted) {
+                MPI_Bcast(&M, 1, MPI_INT, 0, MPI_COMM_WORLD);
+                MPI_Bcast(iperm, M, MPI_INT, 0, MPI_COMM_WORLD);
+            }
             t_end = MPI_Wtime();
             communication_time[iter] += (t_end - t_start);
             
@@ -105,6 +445,9 @@ int main(int argc, char *argv[]) {
                 if (i < remaining_rows) {
                     rows_distribution[i+1]++;
                 }
+                if (use_partition) { // The reordered rows of each part are contiguous
+                    rows_distribution[i+1] = rows_distribution[i] + part_rows[i];
+                }
             }
             
             // print row distribution for debugging
@@ -125,40 +468,110 @@ int main(int argc, char *argv[]) {
             communication_time[iter] += (t_end - t_start);
             
             
-            /* Create vector of size M */
-            vector = (double *) malloc(M * sizeof(double));
+            /* Create vector of size M (block of M x block_k vectors, row-major, with --spmm) */
+            vector = (double *) malloc((size_t) M * block_k * sizeof(double));
             if (!vector) {
                 fprintf(stderr, "Iteration: %d - Process %d failed to allocate memory for random vector\n", iter+1, rank);
                 fflush(stderr);
                 MPI_Abort(MPI_COMM_WORLD, 1);
             }
             
-            for (int i = 0; i < M; i++) {
+            for (int i = 0; i < M * block_k; i++) {
                 vector[i] = (rand() % 9) + 1; // Initialize all elements to 1.0
             }
 
+            // The working processes multiply the reordered matrix, so they get the reordered vector
+            double *sent_vector = vector;
+            if (permuted) {
+                sent_vector = (double *) malloc((size_t) M * block_k * sizeof(double));
+                if (!sent_vector) {
+                    fprintf(stderr, "Iteration: %d - Process %d failed to allocate memory for reordered vector\n", iter+1, rank);
+                    fflush(stderr);
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+                for (int i = 0; i < M; i++) {
+                    for (int t = 0; t < block_k; t++) {
+                        sent_vector[(size_t) i * block_k + t] = vector[(size_t) perm[i] * block_k + t];
+                    }
+                }
+            }
+
 
             /* Send the vector to all processes */
             t_start = MPI_Wtime();
             printf("Iteration: %d - Process %d is sending parts of the vector to other processes.\n", iter+1, rank);
             fflush(stdout);
-            for (int i = 0; i < processes; i++) {
-                MPI_Send(&M, 1, MPI_INT, i+1, // i+1 because rank 0 does not process rows
-                    0, MPI_COMM_WORLD);
-                MPI_Send(vector, M, MPI_DOUBLE, i+1, // i+1 because rank 0 does not process rows
-                    0, MPI_COMM_WORLD);
+            MPI_Bcast(&M, 1, MPI_INT, 0, MPI_COMM_WORLD);
+            MPI_Bcast(&N, 1, MPI_INT, 0, MPI_COMM_WORLD);
+            if (!use_node_shared && !distribute_vector(vector_dist, sent_vector, M * block_k, VECTOR_CHUNK)) {
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            if (use_node_shared) {
+                // The vector goes once to each node leader, the other processes of a node read its copy
+                double *shared_vector;
+                if (!shared_vector_allocate(node_comm, M * block_k, &vector_win, &shared_vector)) {
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+                memcpy(shared_vector, sent_vector, (size_t) M * block_k * sizeof(double));
+                shared_vector_bcast(leader_comm, vector_win, shared_vector, M * block_k);
+                if (iter == 0) {
+                    int nodes;
+                    MPI_Comm_size(leader_comm, &nodes);
+                    printf("Node-aware vector: %d node(s), broadcast to %d node leader(s) instead of sent to %d processes.\n", nodes, nodes - 1, processes);
+                    fflush(stdout);
+                }
             }
             t_end = MPI_Wtime();
             communication_time[iter] += (t_end - t_start);
+            if (sent_vector != vector) {
+                free(sent_vector);
+            }
 
 
             MPI_Barrier(MPI_COMM_WORLD);
             printf("Iteration: %d - Computation started.\n", iter+1);
             fflush(stdout);
 
+            /* Rebalance the rows from the times measured by the working processes */
+            if (adaptive_products) {
+                double *times = (double *) malloc(processes * sizeof(double));
+                int *new_distribution = (int *) malloc(size * sizeof(int));
+                if (!times || !new_distribution) {
+                    fprintf(stderr, "Iteration: %d - Process %d failed to allocate memory for rebalancing\n", iter+1, rank);
+                    fflush(stderr);
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+                for (int i = 0; i < processes; i++) {
+                    MPI_Recv(&times[i], 1, MPI_DOUBLE, i+1, 0, MPI_COMM_WORLD, &status);
+                }
+                double imbalance_before = time_imbalance(processes, times);
+
+                // Each working process places the boundaries falling in its block, rank 0 has none
+                MPI_Bcast(times, processes, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+                MPI_Bcast(rows_distribution, processes + 1, MPI_INT, 0, MPI_COMM_WORLD);
+                for (int i = 0; i <= processes; i++) {
+                    new_distribution[i] = -1;
+                }
+                MPI_Allreduce(MPI_IN_PLACE, new_distribution, processes + 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+                new_distribution[0] = 0;
+                new_distribution[processes] = M;
+
+                for (int i = 0; i < processes; i++) {
+                    MPI_Recv(&times[i], 1, MPI_DOUBLE, i+1, 0, MPI_COMM_WORLD, &status);
+                }
+                printf("Iteration: %d - Adaptive rebalancing: %ld rows moved, time imbalance %.3f before, %.3f after.\n", iter+1,
+                       rows_moved(processes, rows_distribution, new_distribution), imbalance_before, time_imbalance(processes, times));
+                fflush(stdout);
+
+                memcpy(rows_distribution, new_distribution, size * sizeof(int)); // Used to receive the results
+                free(times);
+                free(new_distribution);
+            }
+
             /* Allocate memory for results */
-            results = (double *) malloc(M * sizeof(double));
-            double *local_results = (double *) malloc(M * sizeof(double)); // Max size needed for rank 0
+            int result_M = transposed ? N : M; // A^T x has one entry per column
+            results = (double *) malloc((size_t) result_M * block_k * sizeof(double));
+            double *local_results = (double *) malloc((size_t) result_M * block_k * sizeof(double)); // Max size needed for rank 0
             if (!local_results || !results) {
                 fprintf(stderr, "Iteration: %d - Process %d failed to allocate memory for results\n", iter+1, rank);
                 fflush(stderr);
@@ -166,8 +579,16 @@ int main(int argc, char *argv[]) {
             }
             
 
-            /* Read the matrix into CSR format */
-            if (!read_matrix_to_csr_total(filename, &row_ptr, &J, &vals)) {
+            /* Read the matrix into CSR format (already done with --reorder, mapped with --mmap-cache, streamed with --stream-reference) */
+            if (stream_chunk) {
+                // Only the row pointers are loaded, by the streaming product itself
+            } else if (use_cache) {
+                int cache_M, cache_N;
+                nz_t cache_nz;
+                if (!map_csr_cache(cache_name, populate_cache, &cache_map, &cache_map_size, &cache_M, &cache_N, &cache_nz, &row_ptr, &J, &vals)) {
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+            } else if (!row_ptr && !read_matrix_to_csr_total(filename, &row_ptr, &J, &vals)) {
                 fprintf(stderr, "Process 0 failed reading the whole matrix: %s\n", filename);
                 fflush(stderr);
                 MPI_Abort(MPI_COMM_WORLD, 1);
@@ -183,34 +604,108 @@ int main(int argc, char *argv[]) {
 
 
             /* Compute the SpMV result */
+            // With --spmm the columns of the block are made contiguous before timing the reference
+            double *x_columns = NULL, *y_columns = NULL;
+            if (block_k > 1 && (!block_to_columns(M, block_k, vector, &x_columns) || !block_to_columns(M, block_k, NULL, &y_columns))) {
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            // With --spmm the reference does one SpMV per vector, as it would be done without SpMM
             double local_start = MPI_Wtime();
-            SpMV_csr(M, row_ptr, J, vals, vector, local_results);
+            if (stream_chunk) {
+                double wait_time;
+                long bytes_read;
+                if (!SpMV_csr_stream(cache_name, M, symmetric, stream_chunk, vector, local_results, &wait_time, &bytes_read)) {
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+                double stream_time = MPI_Wtime() - local_start;
+                printf("Iteration: %d - Process 0 streamed %.1f MB of the cache in %f seconds (%.1f MB/s), %f seconds waiting for reads.\n",
+                       iter+1, bytes_read / 1e6, stream_time, bytes_read / 1e6 / stream_time, wait_time);
+                fflush(stdout);
+            } else if (transposed) {
+                SpMV_csr_transpose(M, N, row_ptr, J, vals, vector, local_results);
+            } else if (block_k > 1) {
+                SpMV_csr_columns(M, M, block_k, row_ptr, J, vals, x_columns, y_columns);
+            } else if (use_cache && symmetric && pattern) { // The cache is in the storage of the working processes
+                SpMV_sym_csr_pattern(M, M, 0, row_ptr, J, vector, local_results);
+            } else if (use_cache && symmetric) {
+                SpMV_sym_csr(M, M, 0, row_ptr, J, vals, vector, local_results);
+            } else if (use_cache && pattern) {
+                SpMV_csr_pattern(M, row_ptr, J, vector, local_results);
+            } else {
+                SpMV_csr(M, row_ptr, J, vals, vector, local_results);
+            }
             double local_end = MPI_Wtime();
             not_par_computation_time[iter] = local_end - local_start;
+            if (block_k > 1) {
+                columns_to_block(M, block_k, y_columns, local_results);
+                free(x_columns);
+                free(y_columns);
+            }
+
+            /* Same product on an explicitly transposed CSR, built by a counting sort of the columns */
+            if (transposed) {
+                nz_t *t_row_ptr;
+                int *t_col_idx;
+                double *t_vals;
+                double *explicit_results = (double *) malloc((size_t) N * sizeof(double));
+                local_start = MPI_Wtime();
+                if (!explicit_results || !csr_transpose(M, N, row_ptr, J, vals, &t_row_ptr, &t_col_idx, &t_vals)) {
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+                local_end = MPI_Wtime();
+                transpose_build_time[iter] = local_end - local_start;
+                local_start = MPI_Wtime();
+                if (t_vals) {
+                    SpMV_csr(N, t_row_ptr, t_col_idx, t_vals, vector, explicit_results);
+                } else {
+                    SpMV_csr_pattern(N, t_row_ptr, t_col_idx, vector, explicit_results);
+                }
+                local_end = MPI_Wtime();
+                explicit_transpose_time[iter] = local_end - local_start;
+                printf("Iteration: %d - Process 0 A^T x: %f seconds on the CSR of A, %f seconds on the explicit transpose (built in %f seconds)%s.\n",
+                       iter+1, not_par_computation_time[iter], explicit_transpose_time[iter], transpose_build_time[iter],
+                       check_results(local_results, explicit_results, N) ? "" : " - results differ");
+                fflush(stdout);
+                free(t_row_ptr);
+                free(t_col_idx);
+                free(t_vals);
+                free(explicit_results);
+            }
 
 
             /* Receive back results from all processes */
             t_start = MPI_Wtime();
             
-            int max_M = find_max_M(rows_distribution, processes);
-            double *temp_buffer = (double *) malloc(max_M * sizeof(double));
+            // With symmetric storage each process sends partial results for rows [start_row, last local column]
+            // With --transpose each process has a partial A^T x of all the N columns, they are summed by MPI_Reduce
+            int max_M = transposed ? 1 : symmetric ? M : find_max_M(rows_distribution, processes);
+            double *temp_buffer = (double *) malloc((size_t) max_M * block_k * sizeof(double));
             if (!temp_buffer) {
                 fprintf(stderr, "Iteration: %d - Process %d failed to allocate memory for temp buffer while receiving back results\n", iter+1, rank);
                 fflush(stderr);
                 MPI_Abort(MPI_COMM_WORLD, 1);
             }
 
-            for (int i = 0; i < processes; i++) {
+            for (int i = 0; i < result_M * block_k; i++) {
+                results[i] = 0.0;
+            }
+            if (transposed) {
+                MPI_Reduce(MPI_IN_PLACE, results, N, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+            }
+            for (int i = 0; i < processes && !transposed; i++) {
                 int start_row = rows_distribution[i];
-                int local_M = rows_distribution[i+1] - start_row;
+                int local_M = symmetric ? M - start_row : rows_distribution[i+1] - start_row;
                 if (local_M > max_M) {
                     fprintf(stderr, "Iteration: %d - Process %d found local_M %d larger than max_M %d from process %d\n", iter+1, rank, local_M, max_M, i+1);
                     fflush(stderr);
                     MPI_Abort(MPI_COMM_WORLD, 1);
                 }
-                MPI_Recv(temp_buffer, local_M, MPI_DOUBLE, i+1, 0, MPI_COMM_WORLD, &status);
-                for (int j = 0; j < local_M; j++) {
-                    results[start_row + j] = temp_buffer[j];
+                MPI_Recv(temp_buffer, local_M * block_k, MPI_DOUBLE, i+1, 0, MPI_COMM_WORLD, &status);
+                if (symmetric) {
+                    MPI_Get_count(&status, MPI_DOUBLE, &local_M); // Only up to the last column of its rows
+                }
+                for (int j = 0; j < local_M * block_k; j++) {
+                    results[start_row * block_k + j] += temp_buffer[j]; // Partial results overlap with symmetric storage
                 }
             }
             
@@ -221,6 +716,24 @@ int main(int argc, char *argv[]) {
             t_end = MPI_Wtime();
             communication_time[iter] += (t_end - t_start);
 
+            /* Bring the results back to the original order */
+            // The permutation is only accepted on square matrices, so with --transpose result_M = N = M too
+            if (permuted) {
+                double *reordered = (double *) malloc((size_t) result_M * block_k * sizeof(double));
+                if (!reordered) {
+                    fprintf(stderr, "Iteration: %d - Process %d failed to allocate memory for reordered results\n", iter+1, rank);
+                    fflush(stderr);
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+                memcpy(reordered, results, (size_t) result_M * block_k * sizeof(double));
+                for (int i = 0; i < result_M; i++) {
+                    for (int t = 0; t < block_k; t++) {
+                        results[(size_t) perm[i] * block_k + t] = reordered[(size_t) i * block_k + t];
+                    }
+                }
+                free(reordered);
+            }
+
 
             /* Print result vector */
             /*printf("Process %d results:\n", rank);
@@ -243,7 +756,12 @@ int main(int argc, char *argv[]) {
             /* Verify correctness */
             //printf("Process %d is checking results correctness:\n", rank);
             //fflush(stdout);
-            if (check_results(local_results, results, M)) {
+            if (float_mode) {
+                // Float storage cannot match the double result exactly, report the error instead
+                double max_abs, relative;
+                compute_error(local_results, results, M, &max_abs, &relative);
+                printf("\tIteration: %d - Mixed precision error against double: max absolute %e, relative %e.\n", iter+1, max_abs, relative);
+            } else if (check_results(local_results, results, result_M * block_k)) {
                 printf("\tIteration: %d - Results are correct for MPI parallelization.\n", iter+1);
             } else {
                 printf("\tIteration: %d - Results are NOT correct for MPI parallelization.\n", iter+1);
@@ -268,6 +786,20 @@ int main(int argc, char *argv[]) {
         } else {        
             /* Receive the filename from rank 0 */
             MPI_Bcast(&filename, 256, MPI_CHAR, 0, MPI_COMM_WORLD);
+            MPI_Bcast(matcode, 4, MPI_CHAR, 0, MPI_COMM_WORLD);
+            symmetric = mm_is_symmetric(matcode);
+            pattern = mm_is_pattern(matcode);
+            transposed = use_transpose && !symmetric;
+            if (permuted) {
+                MPI_Bcast(&M, 1, MPI_INT, 0, MPI_COMM_WORLD);
+                iperm = (int *) malloc(M * sizeof(int));
+                if (!iperm) {
+                    fprintf(stderr, "Process %d failed to allocate memory for the reordering\n", rank);
+                    fflush(stderr);
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+                MPI_Bcast(iperm, M, MPI_INT, 0, MPI_COMM_WORLD);
+            }
             
 
             /* Receive the rows distribution from rank 0 */
@@ -280,14 +812,25 @@ int main(int argc, char *argv[]) {
             fflush(stdout);*/
 
             /* Receive the vector from rank 0 */
-            MPI_Recv(&M, 1, MPI_INT, 0, 0, MPI_COMM_WORLD, &status);
-            vector = (double *) malloc(M * sizeof(double));
-            if (!vector) {
-                fprintf(stderr, "Process %d failed to allocate memory for vector\n", rank);
-                fflush(stderr);
-                MPI_Abort(MPI_COMM_WORLD, 1);
+            MPI_Bcast(&M, 1, MPI_INT, 0, MPI_COMM_WORLD);
+            MPI_Bcast(&N, 1, MPI_INT, 0, MPI_COMM_WORLD);
+            if (use_node_shared) {
+                // Read the copy of the node leader, which gets it from rank 0
+                if (!shared_vector_allocate(node_comm, M * block_k, &vector_win, &vector)) {
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+                shared_vector_bcast(leader_comm, vector_win, vector, M * block_k);
+            } else {
+                vector = (double *) malloc((size_t) M * block_k * sizeof(double));
+                if (!vector) {
+                    fprintf(stderr, "Process %d failed to allocate memory for vector\n", rank);
+                    fflush(stderr);
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+                if (!distribute_vector(vector_dist, vector, M * block_k, VECTOR_CHUNK)) {
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
             }
-            MPI_Recv(vector, M, MPI_DOUBLE, 0, 0, MPI_COMM_WORLD, &status);
 
             /* Print received vector */
             //printf("Process %d received vector:\n", rank);
@@ -300,7 +843,9 @@ int main(int argc, char *argv[]) {
             MPI_Barrier(MPI_COMM_WORLD);
 
             /* Receive result vector to fill */
-            results = (double *) malloc(local_M * sizeof(double));
+            // With symmetric storage the transposed part reaches every row after start_row, with --transpose every column
+            int results_M = transposed ? N : symmetric ? M - start_row : local_M;
+            results = (double *) malloc((size_t) results_M * block_k * sizeof(double));
             if (!results) {
                 fprintf(stderr, "Process %d failed to allocate memory for results vector\n", rank);
                 fflush(stderr);
@@ -308,13 +853,28 @@ int main(int argc, char *argv[]) {
             }
             
 
-            if (!read_matrix_to_csr_partial(filename, start_row, end_row, &nz, &row_ptr, &J, &vals)) {
+            if (use_cache) {
+                int cache_M, cache_N;
+                snprintf(cache_name, sizeof(cache_name), "%s.csr", filename);
+                if (!map_csr_cache(cache_name, populate_cache, &cache_map, &cache_map_size, &cache_M, &cache_N, &nz, &row_ptr, &J, &vals)) {
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+                row_ptr += start_row; // Global offsets into J and vals, the rows are used in place
+                nz = row_ptr[local_M] - row_ptr[0];
+            } else if (!read_matrix_to_csr_partial(filename, start_row, end_row, matcode, iperm, &nz, &row_ptr, &J, &vals)) {
                 fprintf(stderr, "Process %d failed reading its part of the matrix: %s\n", rank, filename);
                 fflush(stderr);
                 MPI_Abort(MPI_COMM_WORLD, 1);
             }
             //printf("Process %d read its part of the matrix with %d non-zero elements.\n", rank, local_nz);
             //fflush(stdout);
+
+            // With symmetric storage only the rows up to the last local column get partial results, rank 0 reads the count
+            int sym_reach = M;
+            if (symmetric) {
+                sym_reach = sym_csr_reach(local_M, start_row, row_ptr, J);
+                results_M = sym_reach - start_row;
+            }
             
             /* Printf matrix rows and values */
             //printf("Process %d CSR Row pointer:\n", rank);
@@ -323,11 +883,184 @@ int main(int argc, char *argv[]) {
             }
             fflush(stdout);*/
 
+            /* Compress the column indices if requested */
+            if (use_csr_du && !symmetric && !pattern) {
+                if (!csr_to_csr_du(local_M, row_ptr, J, vals, &du_ctl, &du_ctl_size)) {
+                    fprintf(stderr, "Process %d failed converting its part of the matrix to CSR-DU\n", rank);
+                    fflush(stderr);
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+                if (iter == 0) {
+                    // Index bytes read by the kernels: CSR streams row_ptr and the column indices, CSR-DU only the ctl stream
+                    printf("Process %d CSR-DU index bytes: %ld instead of %ld\n", rank,
+                           (long) du_ctl_size, (long) ((local_M + 1) * sizeof(nz_t) + nz * sizeof(int)));
+                    fflush(stdout);
+                }
+            }
+
+            /* Cut the local rows in square blocks if requested */
+            if (use_csb && !symmetric && !pattern) {
+                if (!csb_beta) {
+                    csb_beta = csb_default_beta(local_M, N);
+                }
+                if (!csr_to_csb(local_M, N, row_ptr, J, vals, csb_beta, &csb_blk_ptr, &csb_row, &csb_col, &csb_vals)) {
+                    fprintf(stderr, "Process %d failed converting its part of the matrix to CSB\n", rank);
+                    fflush(stderr);
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+                if (iter == 0) {
+                    // Index bytes: CSR has a pointer per row and a 32 bit column per non-zero, CSB a pointer per block and two 16 bit indices
+                    long blocks = ((long) local_M + csb_beta - 1) / csb_beta * (((long) N + csb_beta - 1) / csb_beta);
+                    printf("Process %d CSB indices (beta %d, %ld blocks): %ld bytes instead of %ld\n", rank, csb_beta, blocks,
+                           (blocks + 1) * (long) sizeof(nz_t) + (long) nz * 2 * sizeof(uint16_t),
+                           ((long) local_M + 1) * (long) sizeof(nz_t) + (long) nz * sizeof(int));
+                    fflush(stdout);
+                }
+            }
+
+            /* Replace the values with a dictionary if requested, when there are few distinct values */
+            if (use_vi && !symmetric && !pattern) {
+                int distinct = count_distinct_values(nz, vals, VI_MAX_DICT);
+                if (csr_vi_is_worth(nz, distinct)) {
+                    if (!csr_to_csr_vi(nz, vals, &vi_dict, &vi_dict_size, &vi_codes, &vi_code_bytes)) {
+                        fprintf(stderr, "Process %d failed building the value dictionary\n", rank);
+                        fflush(stderr);
+                        MPI_Abort(MPI_COMM_WORLD, 1);
+                    }
+                    free(vals); // Not needed anymore, the codes replace them
+                    vals = NULL;
+                }
+                if (iter == 0) {
+                    if (vi_codes) {
+                        printf("Process %d value dictionary: %d distinct values, %d bit codes\n", rank, vi_dict_size, vi_code_bytes * 8);
+                    } else {
+                        printf("Process %d value dictionary: too many distinct values, keeping CSR\n", rank);
+                    }
+                    fflush(stdout);
+                }
+            }
+
+            /* Store values (and vector) in float if requested */
+            if (float_mode && !symmetric && !pattern) {
+                if (!double_to_float(nz, vals, &vals_f)) {
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+                free(vals); // Not needed anymore, vals_f replaces them
+                vals = NULL;
+                if (float_mode == 2 && !double_to_float(M, vector, &vector_f)) {
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+            }
+
+            /* Measure, rebalance the rows with the other working processes and measure again if requested */
+            if (adaptive_products) {
+                int *old_distribution = (int *) malloc(size * sizeof(int));
+                int *new_distribution = (int *) malloc(size * sizeof(int));
+                double *times = (double *) malloc(processes * sizeof(double));
+                if (!old_distribution || !new_distribution || !times) {
+                    fprintf(stderr, "Process %d failed to allocate memory for rebalancing\n", rank);
+                    fflush(stderr);
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+                for (int phase = 0; phase < 2; phase++) {
+                    if (phase == 1) {
+                        // New boundaries from the times and blocks of all the working processes
+                        MPI_Bcast(times, processes, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+                        MPI_Bcast(old_distribution, processes + 1, MPI_INT, 0, MPI_COMM_WORLD);
+                        rebalance_boundaries(processes, rank-1, old_distribution, times, row_ptr, new_distribution);
+                        MPI_Allreduce(MPI_IN_PLACE, new_distribution, processes + 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+                        new_distribution[0] = 0;
+                        new_distribution[processes] = M;
+
+                        if (!migrate_rows(1, processes, rank-1, old_distribution, new_distribution, pattern, &row_ptr, &J, &vals)) {
+                            MPI_Abort(MPI_COMM_WORLD, 1);
+                        }
+                        start_row = new_distribution[rank-1];
+                        end_row = new_distribution[rank];
+                        local_M = end_row - start_row;
+                        if (symmetric) {
+                            sym_reach = sym_csr_reach(local_M, start_row, row_ptr, J);
+                        }
+                        results_M = symmetric ? sym_reach - start_row : local_M;
+                        free(results);
+                        results = (double *) malloc(((size_t) results_M + 1) * sizeof(double));
+                        if (!results) {
+                            fprintf(stderr, "Process %d failed to allocate memory for results vector\n", rank);
+                            fflush(stderr);
+                            MPI_Abort(MPI_COMM_WORLD, 1);
+                        }
+                    }
+
+                    t_start = MPI_Wtime();
+                    for (int r = 0; r < adaptive_products; r++) {
+                        if (symmetric && pattern) {
+                            SpMV_sym_csr_pattern(local_M, sym_reach, start_row, row_ptr, J, vector, results);
+                        } else if (symmetric) {
+                            SpMV_sym_csr(local_M, sym_reach, start_row, row_ptr, J, vals, vector, results);
+                        } else if (pattern) {
+                            SpMV_csr_pattern(local_M, row_ptr, J, vector, results);
+                        } else {
+                            SpMV_csr(local_M, row_ptr, J, vals, vector, results);
+                        }
+                    }
+                    t_end = MPI_Wtime();
+                    double measured_time = t_end - t_start;
+                    MPI_Send(&measured_time, 1, MPI_DOUBLE, 0, 0, MPI_COMM_WORLD);
+                }
+                free(old_distribution);
+                free(new_distribution);
+                free(times);
+            }
+
+            /* Keep only the non-empty rows if most of the local rows are empty (after any rebalancing) */
+            if (use_dcsr && !transposed && !symmetric && block_k == 1 && !du_ctl && !vi_codes && !vals_f && !csb_blk_ptr) {
+                dcsr_rows = count_nonempty_rows(local_M, row_ptr);
+                if (dcsr_is_worth(local_M, dcsr_rows)) {
+                    if (!csr_to_dcsr(local_M, row_ptr, dcsr_rows, &dcsr_row_ids, &dcsr_ptr)) {
+                        fprintf(stderr, "Process %d failed converting its part of the matrix to DCSR\n", rank);
+                        fflush(stderr);
+                        MPI_Abort(MPI_COMM_WORLD, 1);
+                    }
+                    if (iter == 0) {
+                        printf("Process %d DCSR: %d non-empty rows of %d\n", rank, dcsr_rows, local_M);
+                        fflush(stdout);
+                    }
+                }
+            }
+
             /* Compute the SpMV result */
             t_start = MPI_Wtime();
             //printf("Process %d is computing its SpMV part.\n", rank);
             //fflush(stdout);
-            SpMV_csr(local_M, row_ptr, J, vals, vector, results);
+            if (transposed && csb_blk_ptr) {
+                SpMV_csb_transpose(local_M, N, csb_beta, csb_blk_ptr, csb_row, csb_col, csb_vals, vector + start_row, results);
+            } else if (transposed) {
+                SpMV_csr_transpose(local_M, N, row_ptr, J, vals, vector + start_row, results); // The local rows use their part of x
+            } else if (block_k > 1) {
+                SpMM_csr(local_M, block_k, row_ptr, J, vals, vector, results);
+            } else if (du_ctl) {
+                SpMV_csr_du(du_ctl, du_ctl_size, vals, vector, results);
+            } else if (csb_blk_ptr) {
+                SpMV_csb(local_M, N, csb_beta, csb_blk_ptr, csb_row, csb_col, csb_vals, vector, results);
+            } else if (vi_codes && vi_code_bytes == 1) {
+                SpMV_csr_vi8(local_M, row_ptr, J, vi_dict, (uint8_t *) vi_codes, vector, results);
+            } else if (vi_codes) {
+                SpMV_csr_vi16(local_M, row_ptr, J, vi_dict, (uint16_t *) vi_codes, vector, results);
+            } else if (vector_f) {
+                SpMV_csr_float_x(local_M, row_ptr, J, vals_f, vector_f, results);
+            } else if (vals_f) {
+                SpMV_csr_float(local_M, row_ptr, J, vals_f, vector, results);
+            } else if (dcsr_row_ids) {
+                SpMV_dcsr(local_M, dcsr_rows, dcsr_row_ids, dcsr_ptr, J, pattern ? NULL : vals, vector, results);
+            } else if (symmetric && pattern) {
+                SpMV_sym_csr_pattern(local_M, sym_reach, start_row, row_ptr, J, vector, results);
+            } else if (symmetric) {
+                SpMV_sym_csr(local_M, sym_reach, start_row, row_ptr, J, vals, vector, results);
+            } else if (pattern) {
+                SpMV_csr_pattern(local_M, row_ptr, J, vector, results);
+            } else {
+                SpMV_csr(local_M, row_ptr, J, vals, vector, results);
+            }
 
             /* Print result vector */
             //printf("Process %d results:\n", rank);
@@ -340,7 +1073,11 @@ int main(int argc, char *argv[]) {
             double local_comp_time = t_end - t_start;
 
             /* Send back results to rank 0 */
-            MPI_Send(results, local_M, MPI_DOUBLE, 0, 0, MPI_COMM_WORLD);
+            if (transposed) {
+                MPI_Reduce(results, NULL, N, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+            } else {
+                MPI_Send(results, results_M * block_k, MPI_DOUBLE, 0, 0, MPI_COMM_WORLD);
+            }
 
             /* Send computation time to rank 0 */
             MPI_Send(&local_comp_time, 1, MPI_DOUBLE, 0, 0, MPI_COMM_WORLD);
@@ -352,6 +1089,14 @@ int main(int argc, char *argv[]) {
         // Barrier to ensure all processes finished using heap memory before freeing
         MPI_Barrier(MPI_COMM_WORLD);
 
+        if (cache_map) { // The matrix points into the mapping
+            row_ptr = NULL;
+            J = NULL;
+            vals = NULL;
+            unmap_csr_cache(cache_map, cache_map_size);
+            cache_map = NULL;
+        }
+
         if (row_ptr) {
             free(row_ptr);
             row_ptr = NULL;
@@ -368,6 +1113,64 @@ int main(int argc, char *argv[]) {
             free(results);
             results = NULL;
         }
+        if (du_ctl) {
+            free(du_ctl);
+            du_ctl = NULL;
+        }
+        if (dcsr_row_ids) {
+            free(dcsr_row_ids);
+            free(dcsr_ptr);
+            dcsr_row_ids = NULL;
+            dcsr_ptr = NULL;
+        }
+        if (csb_blk_ptr) {
+            free(csb_blk_ptr);
+            free(csb_row);
+            free(csb_col);
+            free(csb_vals);
+            csb_blk_ptr = NULL;
+            csb_row = NULL;
+            csb_col = NULL;
+            csb_vals = NULL;
+        }
+        if (vi_dict) {
+            free(vi_dict);
+            vi_dict = NULL;
+        }
+        if (vi_codes) {
+            free(vi_codes);
+            vi_codes = NULL;
+        }
+        if (vals_f) {
+            free(vals_f);
+            vals_f = NULL;
+        }
+        if (vector_f) {
+            free(vector_f);
+            vector_f = NULL;
+        }
+        if (perm) {
+            free(perm);
+            perm = NULL;
+        }
+        if (iperm) {
+            free(iperm);
+            iperm = NULL;
+        }
+        if (part) {
+            free(part);
+            part = NULL;
+        }
+        if (part_rows) {
+            free(part_rows);
+            part_rows = NULL;
+        }
+        if (vector_win != MPI_WIN_NULL) {
+            if (rank != 0) {
+                vector = NULL; // It is the copy of the node leader, freed with the window
+            }
+            MPI_Win_free(&vector_win);
+        }
         if (vector) {
             free(vector);
             vector = NULL;
@@ -421,6 +1224,16 @@ int main(int argc, char *argv[]) {
         fprintf(f, "avg_total_time: %f\n", avg_total_time);
         fprintf(f, "not_par_comp_time: %f\n", not_par_comp_time);
         fprintf(f, "speedup: %f\n", speedup);
+        if (transposed) {
+            double build_time = 0.0, explicit_time = 0.0;
+            remove_outlier(num_iterations, transpose_build_time, &build_time);
+            remove_outlier(num_iterations, explicit_transpose_time, &explicit_time);
+            printf("A^T x on rank 0: %f seconds on the CSR of A, %f seconds on the explicit transpose, %f seconds to build it.\n\n",
+                   not_par_comp_time, explicit_time, build_time);
+            fflush(stdout);
+            fprintf(f, "transpose_build_time: %f\n", build_time);
+            fprintf(f, "explicit_transpose_time: %f\n", explicit_time);
+        }
         fflush(f);
         fclose(f);
     }
@@ -430,6 +1243,14 @@ int main(int argc, char *argv[]) {
     free(computation_time);
     free(communication_time);
     free(not_par_computation_time);
+    free(transpose_build_time);
+    free(explicit_transpose_time);
+    if (node_comm != MPI_COMM_NULL) {
+        MPI_Comm_free(&node_comm);
+    }
+    if (leader_comm != MPI_COMM_NULL) {
+        MPI_Comm_free(&leader_comm);
+    }
     
 
     MPI_Finalize();
@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libraries/data_management.h"
+#include "libraries/vector_distribution.h"
+#include <mpi.h>
+
+/* Vector sizes used without arguments: the test matrices and larger generated ones */
+static const int default_sizes[] = {4096, 14734, 131072, 1048576, 8388608};
+
+int main(int argc, char *argv[]) {
+    int rank, size, num_iterations;
+    char result_filename[256] = "";
+
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+
+    if (size < 2) {
+        if (rank == 0) {
+            fprintf(stderr, "Error: run with at least 2 processes.\n");
+            fflush(stderr);
+        }
+        MPI_Finalize();
+        exit(1);
+    }
+
+    /* Check the right amount of argument */
+    if (argc < 3) {
+        if (rank == 0) {
+            fprintf(stderr, "Intended usage: %s [iterations] [plot-result-file] [vector-sizes...]\n", argv[0]);
+            fflush(stderr);
+        }
+        MPI_Finalize();
+        exit(1);
+    }
+
+    num_iterations = atoi(argv[1]); // Number of times each distribution is repeated for averaging
+    if (num_iterations < 1) {
+        if (rank == 0) {
+            fprintf(stderr, "The number of iterations must be at least 1\n");
+            fflush(stderr);
+        }
+        MPI_Finalize();
+        exit(1);
+    }
+    snprintf(result_filename, sizeof(result_filename), "%s", argv[2]); // File to store results
+
+    int num_sizes = (argc > 3) ? argc - 3 : (int) (sizeof(default_sizes) / sizeof(default_sizes[0]));
+
+    /* Allocating memory */
+    double *times = (double *) malloc(num_iterations * sizeof(double));
+    double avg_times[VECTOR_METHODS];
+    if (!times) {
+        fprintf(stderr, "Process %d failed to allocate memory for timing arrays\n", rank);
+        fflush(stderr);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    for (int s = 0; s < num_sizes; s++) {
+        int M = (argc > 3) ? atoi(argv[3 + s]) : default_sizes[s];
+        double *vector = (double *) malloc(((size_t) M + 1) * sizeof(double));
+        if (!vector || M < 1) {
+            fprintf(stderr, "Process %d failed to allocate memory for a vector of size %d\n", rank, M);
+            fflush(stderr);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+
+        for (int method = 0; method < VECTOR_METHODS; method++) {
+            bool correct = true;
+            for (int iter = 0; iter < num_iterations; iter++) {
+                for (int i = 0; i < M; i++) {
+                    vector[i] = (rank == 0) ? (double) i : -1.0;
+                }
+
+                // Time until the last process has the vector
+                MPI_Barrier(MPI_COMM_WORLD);
+                double t_start = MPI_Wtime();
+                if (!distribute_vector(method, vector, M, VECTOR_CHUNK)) {
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+                double local_time = MPI_Wtime() - t_start;
+                MPI_Reduce(&local_time, &times[iter], 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+                for (int i = 0; i < M; i++) {
+                    if (vector[i] != (double) i) {
+                        correct = false;
+                        break;
+                    }
+                }
+            }
+
+            int all_correct = correct;
+            MPI_Allreduce(MPI_IN_PLACE, &all_correct, 1, MPI_INT, MPI_LAND, MPI_COMM_WORLD);
+            if (rank == 0) {
+                avg_times[method] = 0.0;
+                remove_outlier(num_iterations, times, &avg_times[method]);
+                printf("Vector %d - %d processes - %-8s: %f seconds, %.1f MB/s%s\n", M, size, vector_distribution_name(method),
+                       avg_times[method], (double) M * sizeof(double) * (size - 1) / avg_times[method] / 1e6,
+                       all_correct ? "" : " - NOT correct");
+                fflush(stdout);
+            }
+        }
+
+        /* Write results to file */
+        if (rank == 0) {
+            FILE *f;
+            if ((f = fopen(result_filename, "a")) == NULL) {
+                fprintf(stderr, "Could not open file: %s\n", result_filename);
+                fflush(stderr);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            fprintf(f, "#Vector: %d - Processes: %d\n", M, size);
+            for (int method = 0; method < VECTOR_METHODS; method++) {
+                fprintf(f, "%s_time: %f\n", vector_distribution_name(method), avg_times[method]);
+            }
+            fflush(f);
+            fclose(f);
+        }
+
+        free(vector);
+    }
+
+    free(times);
+
+    MPI_Finalize();
+    return 0;
+}
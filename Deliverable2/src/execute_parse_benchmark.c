@@ -0,0 +1,203 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include "libraries/data_management.h"
+#include "libraries/matrix_input.h"
+#include "libraries/fast_parse.h"
+
+/*
+ * Parser microbenchmark: the entry lines of each matrix are loaded in memory once, then parsed
+ * with the old path (strtol, strtol, strtod) and with parse_int/parse_double, so only the
+ * parsing is timed. The values of the two parsers are compared bit for bit.
+ */
+
+#define PARSERS 2
+static const char *parser_names[PARSERS] = {"strtod", "fast"};
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static bool load_entries(char *filename, char **text, char ***lines, long *count, bool *pattern) {
+    // All the entry lines, each one terminated by '\0' in a single buffer
+    FILE *f = open_matrix_input(filename);
+    if (!f) {
+        fprintf(stderr, "Could not open file: %s\n", filename);
+        fflush(stderr);
+        return false;
+    }
+    char line[256];
+    long long M, N, entries;
+    *pattern = false;
+    do {
+        if (!fgets(line, sizeof(line), f)) {
+            fclose(f);
+            return false;
+        }
+        if (strncmp(line, "%%MatrixMarket", 14) == 0) {
+            *pattern = strstr(line, "pattern") != NULL;
+        }
+    } while (line[0] == '%');
+    if (sscanf(line, "%lld %lld %lld", &M, &N, &entries) != 3) {
+        fclose(f);
+        return false;
+    }
+
+    size_t capacity = 1 << 20, used = 0;
+    *text = (char *) malloc(capacity);
+    long *offsets = (long *) malloc((entries + 1) * sizeof(long));
+    if (!*text || !offsets) {
+        fclose(f);
+        free(offsets);
+        return false;
+    }
+    *count = 0;
+    while (*count < entries && fgets(line, sizeof(line), f)) {
+        size_t len = strlen(line) + 1;
+        if (used + len > capacity) {
+            capacity *= 2;
+            char *grown = (char *) realloc(*text, capacity);
+            if (!grown) {
+                fclose(f);
+                free(offsets);
+                return false;
+            }
+            *text = grown;
+        }
+        memcpy(*text + used, line, len);
+        offsets[(*count)++] = (long) used;
+        used += len;
+    }
+    fclose(f);
+
+    // Pointers only once the buffer stops moving
+    *lines = (char **) malloc((*count + 1) * sizeof(char *));
+    if (!*lines) {
+        free(offsets);
+        return false;
+    }
+    for (long i = 0; i < *count; i++) {
+        (*lines)[i] = *text + offsets[i];
+    }
+    free(offsets);
+    return true;
+}
+
+static void parse_entries(int parser, char **lines, long count, bool pattern, int *rows, int *cols, double *vals) {
+    for (long i = 0; i < count; i++) {
+        char *p = lines[i];
+        if (parser == 0) {
+            rows[i] = (int) strtol(p, &p, 10);
+            cols[i] = (int) strtol(p, &p, 10);
+            vals[i] = pattern ? 1.0 : strtod(p, NULL);
+        } else {
+            p = parse_int(p, &rows[i]);
+            p = parse_int(p, &cols[i]);
+            vals[i] = 1.0;
+            if (!pattern) {
+                parse_double(p, &vals[i]);
+            }
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 4) {
+        fprintf(stderr, "Intended usage: %s [iterations] [plot-result-file] [matrix-files...]\n", argv[0]);
+        fflush(stderr);
+        exit(1);
+    }
+    int num_iterations = atoi(argv[1]);
+    if (num_iterations < 1) {
+        fprintf(stderr, "The number of iterations must be at least 1\n");
+        fflush(stderr);
+        exit(1);
+    }
+    char *result_filename = argv[2];
+
+    double *times = (double *) malloc(num_iterations * sizeof(double));
+    if (!times) {
+        fprintf(stderr, "Failed to allocate memory for timing arrays\n");
+        fflush(stderr);
+        exit(1);
+    }
+
+    for (int m = 3; m < argc; m++) {
+        char *text = NULL, **lines = NULL;
+        long count = 0;
+        bool pattern;
+        if (!load_entries(argv[m], &text, &lines, &count, &pattern)) {
+            fprintf(stderr, "Failed reading the entries of: %s\n", argv[m]);
+            fflush(stderr);
+            free(text);
+            continue;
+        }
+
+        int *rows[PARSERS], *cols[PARSERS];
+        double *vals[PARSERS];
+        double avg_times[PARSERS];
+        for (int parser = 0; parser < PARSERS; parser++) {
+            rows[parser] = (int *) malloc((count + 1) * sizeof(int));
+            cols[parser] = (int *) malloc((count + 1) * sizeof(int));
+            vals[parser] = (double *) malloc((count + 1) * sizeof(double));
+            if (!rows[parser] || !cols[parser] || !vals[parser]) {
+                fprintf(stderr, "Failed to allocate memory for %ld entries\n", count);
+                fflush(stderr);
+                exit(1);
+            }
+            for (int iter = 0; iter < num_iterations; iter++) {
+                double t_start = now();
+                parse_entries(parser, lines, count, pattern, rows[parser], cols[parser], vals[parser]);
+                times[iter] = now() - t_start;
+            }
+            avg_times[parser] = 0.0;
+            remove_outlier(num_iterations, times, &avg_times[parser]);
+        }
+
+        // Same indices and the same bits for every value
+        long mismatches = 0;
+        for (long i = 0; i < count; i++) {
+            if (rows[0][i] != rows[1][i] || cols[0][i] != cols[1][i] || memcmp(&vals[0][i], &vals[1][i], sizeof(double)) != 0) {
+                mismatches++;
+            }
+        }
+
+        printf("Matrix %s - %ld entries\n", argv[m], count);
+        for (int parser = 0; parser < PARSERS; parser++) {
+            printf("\t%-6s: %f seconds, %.1f M entries/s\n", parser_names[parser], avg_times[parser], count / avg_times[parser] / 1e6);
+        }
+        printf("\tSpeedup: %.2f - %s\n", avg_times[0] / avg_times[1], mismatches ? "values NOT identical" : "identical values");
+        if (mismatches) {
+            printf("\t%ld entries differ\n", mismatches);
+        }
+        fflush(stdout);
+
+        FILE *f;
+        if ((f = fopen(result_filename, "a")) == NULL) {
+            fprintf(stderr, "Could not open file: %s\n", result_filename);
+            fflush(stderr);
+            exit(1);
+        }
+        fprintf(f, "#Matrix: %s - Entries: %ld\n", argv[m], count);
+        for (int parser = 0; parser < PARSERS; parser++) {
+            fprintf(f, "%s_time: %f\n", parser_names[parser], avg_times[parser]);
+        }
+        fflush(f);
+        fclose(f);
+
+        for (int parser = 0; parser < PARSERS; parser++) {
+            free(rows[parser]);
+            free(cols[parser]);
+            free(vals[parser]);
+        }
+        free(lines);
+        free(text);
+    }
+
+    free(times);
+    return 0;
+}
@@ -1,21 +1,298 @@
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include "SpMV.h"
 
-void SpMV_csr(int M, int *row_ptr, int *col_idx, double *vals, double *vector, double *result) {
+void SpMV_csr(int M, nz_t *row_ptr, int *col_idx, double *vals, double *vector, double *result) {
     for (int i = 0; i < M; i++) { // Loop over local rows
         double sum = 0.0;
         // Go through each non-zero element in the row
-        for (int j = row_ptr[i]; j < row_ptr[i+1]; j++) {
+        for (nz_t j = row_ptr[i]; j < row_ptr[i+1]; j++) {
             sum += vals[j] * vector[col_idx[j]];
         }
         result[i] = sum;
     }
 }
 
+void SpMV_sym_csr(int M, int N, int start_row, nz_t *row_ptr, int *col_idx, double *vals, double *vector, double *result) {
+    // Only the upper triangle (col >= row) of the local rows is stored, so every entry
+    // also contributes to row "col" through the transposed part.
+    // Those rows can be outside the local range: result covers rows [start_row, N) and
+    // is private to the caller, the partial results are summed afterwards (by rank 0).
+    // N only needs to reach the last column of the local rows (sym_csr_reach): the clear below
+    // is part of the product and costs N - start_row, not the number of rows of the matrix
+    for (int i = 0; i < N - start_row; i++) {
+        result[i] = 0.0;
+    }
+
+    for (int i = 0; i < M; i++) { // Loop over local rows
+        int row = start_row + i;
+        double x_row = vector[row];
+        double sum = 0.0;
+        for (nz_t j = row_ptr[i]; j < row_ptr[i+1]; j++) {
+            int col = col_idx[j];
+            sum += vals[j] * vector[col]; // Row contribution
+            if (col != row) {
+                result[col - start_row] += vals[j] * x_row; // Transposed contribution
+            }
+        }
+        result[i] += sum;
+    }
+}
+
+int sym_csr_reach(int M, int start_row, nz_t *row_ptr, int *col_idx) {
+    // End of the rows reached by the local rows in symmetric storage: their own rows and the largest column
+    int reach = start_row + M;
+    for (nz_t j = row_ptr[0]; j < row_ptr[M]; j++) {
+        if (col_idx[j] + 1 > reach) {
+            reach = col_idx[j] + 1;
+        }
+    }
+    return reach;
+}
+
+void SpMV_csr_pattern(int M, nz_t *row_ptr, int *col_idx, double *vector, double *result) {
+    // Every value of a pattern matrix is 1, so only the gathered vector entries are summed
+    for (int i = 0; i < M; i++) {
+        double sum = 0.0;
+        for (nz_t j = row_ptr[i]; j < row_ptr[i+1]; j++) {
+            sum += vector[col_idx[j]];
+        }
+        result[i] = sum;
+    }
+}
+
+void SpMV_sym_csr_pattern(int M, int N, int start_row, nz_t *row_ptr, int *col_idx, double *vector, double *result) {
+    // Same as SpMV_sym_csr, with every value equal to 1
+    for (int i = 0; i < N - start_row; i++) {
+        result[i] = 0.0;
+    }
+
+    for (int i = 0; i < M; i++) {
+        int row = start_row + i;
+        double x_row = vector[row];
+        double sum = 0.0;
+        for (nz_t j = row_ptr[i]; j < row_ptr[i+1]; j++) {
+            int col = col_idx[j];
+            sum += vector[col];
+            if (col != row) {
+                result[col - start_row] += x_row;
+            }
+        }
+        result[i] += sum;
+    }
+}
+
+/*
+ * SpMM: Y = A * X, with X (N x k) and Y (M x k) stored row-major, so the k entries
+ * used by one non-zero are contiguous. Each loaded non-zero is reused k times.
+ * For the common block sizes the k loop has a compile-time bound, so it is fully
+ * unrolled and vectorized by the compiler.
+ */
+#define SPMM_CSR_FIXED(K) \
+static void SpMM_csr_k##K(int M, nz_t *row_ptr, int *col_idx, double *vals, double *X, double *Y) { \
+    for (int i = 0; i < M; i++) { \
+        double sum[K] = {0.0}; \
+        for (nz_t j = row_ptr[i]; j < row_ptr[i+1]; j++) { \
+            double val = vals[j]; \
+            const double *x = &X[(size_t) col_idx[j] * K]; \
+            for (int t = 0; t < K; t++) { \
+                sum[t] += val * x[t]; \
+            } \
+        } \
+        for (int t = 0; t < K; t++) { \
+            Y[(size_t) i * K + t] = sum[t]; \
+        } \
+    } \
+}
+
+SPMM_CSR_FIXED(2)
+SPMM_CSR_FIXED(4)
+SPMM_CSR_FIXED(8)
+SPMM_CSR_FIXED(16)
+
+void SpMM_csr(int M, int k, nz_t *row_ptr, int *col_idx, double *vals, double *X, double *Y) {
+    switch (k) {
+        case 1: SpMV_csr(M, row_ptr, col_idx, vals, X, Y); return;
+        case 2: SpMM_csr_k2(M, row_ptr, col_idx, vals, X, Y); return;
+        case 4: SpMM_csr_k4(M, row_ptr, col_idx, vals, X, Y); return;
+        case 8: SpMM_csr_k8(M, row_ptr, col_idx, vals, X, Y); return;
+        case 16: SpMM_csr_k16(M, row_ptr, col_idx, vals, X, Y); return;
+        default: break;
+    }
+
+    // Generic block size
+    for (int i = 0; i < M; i++) {
+        double *y = &Y[(size_t) i * k];
+        for (int t = 0; t < k; t++) {
+            y[t] = 0.0;
+        }
+        for (nz_t j = row_ptr[i]; j < row_ptr[i+1]; j++) {
+            double val = vals[j];
+            const double *x = &X[(size_t) col_idx[j] * k];
+            for (int t = 0; t < k; t++) {
+                y[t] += val * x[t];
+            }
+        }
+    }
+}
+
+bool block_to_columns(int n, int k, double *X, double **columns) {
+    // Column t of the row-major block X (n x k) becomes the contiguous vector columns[t*n ... t*n+n-1]
+    *columns = (double *) malloc(((size_t) n * k + 1) * sizeof(double));
+    if (!(*columns)) {
+        fprintf(stderr, "Failed to allocate memory for the columns of the vector block\n");
+        fflush(stderr);
+        return false;
+    }
+    if (X) {
+        for (int t = 0; t < k; t++) {
+            for (int i = 0; i < n; i++) {
+                (*columns)[(size_t) t * n + i] = X[(size_t) i * k + t];
+            }
+        }
+    }
+    return true;
+}
+
+void columns_to_block(int n, int k, double *columns, double *Y) {
+    for (int t = 0; t < k; t++) {
+        for (int i = 0; i < n; i++) {
+            Y[(size_t) i * k + t] = columns[(size_t) t * n + i];
+        }
+    }
+}
+
+void SpMV_csr_columns(int M, int N, int k, nz_t *row_ptr, int *col_idx, double *vals, double *x_columns, double *y_columns) {
+    // Same product as SpMM_csr, with one SpMV_csr per vector (used as reference): the columns are
+    // already contiguous (block_to_columns), so only the k plain products are timed
+    for (int t = 0; t < k; t++) {
+        SpMV_csr(M, row_ptr, col_idx, vals, x_columns + (size_t) t * N, y_columns + (size_t) t * M);
+    }
+}
+
+void SpMV_csr_transpose(int M, int N, nz_t *row_ptr, int *col_idx, double *vals, double *vector, double *result) {
+    // y = A^T x on the CSR of A (M x N), without building A^T: row i scatters vals[j] * x[i] into y[col_idx[j]]
+    // vector has the M entries of the rows, result the N entries of the columns; vals is NULL for pattern matrices
+    for (int i = 0; i < N; i++) {
+        result[i] = 0.0;
+    }
+    for (int i = 0; i < M; i++) {
+        double x_row = vector[i];
+        if (vals) {
+            for (nz_t j = row_ptr[i]; j < row_ptr[i+1]; j++) {
+                result[col_idx[j]] += vals[j] * x_row;
+            }
+        } else {
+            for (nz_t j = row_ptr[i]; j < row_ptr[i+1]; j++) {
+                result[col_idx[j]] += x_row;
+            }
+        }
+    }
+}
+
+bool csr_transpose(int M, int N, nz_t *row_ptr, int *col_idx, double *vals, nz_t **t_row_ptr, int **t_col_idx, double **t_vals) {
+    // Explicit CSR of A^T (N x M): the entries are counted per column, then placed row by row,
+    // so the columns of each transposed row stay sorted. *t_vals is NULL when vals is (pattern matrices)
+    nz_t base = row_ptr[0]; // Rows used in place from a mapped cache start at a global offset
+    nz_t nz = row_ptr[M] - base;
+    nz_t *next = (nz_t *) malloc(((size_t) N + 1) * sizeof(nz_t));
+    *t_row_ptr = (nz_t *) calloc((size_t) N + 1, sizeof(nz_t));
+    *t_col_idx = (int *) malloc(((size_t) nz + 1) * sizeof(int));
+    *t_vals = vals ? (double *) malloc(((size_t) nz + 1) * sizeof(double)) : NULL;
+    if (!next || !(*t_row_ptr) || !(*t_col_idx) || (vals && !(*t_vals))) {
+        fprintf(stderr, "Failed to allocate memory for the transposed matrix (%ld non-zeros)\n", (long) nz);
+        fflush(stderr);
+        free(next);
+        free(*t_row_ptr);
+        free(*t_col_idx);
+        free(*t_vals);
+        return false;
+    }
+
+    for (nz_t j = base; j < row_ptr[M]; j++) {
+        (*t_row_ptr)[col_idx[j] + 1]++;
+    }
+    for (int i = 0; i < N; i++) {
+        (*t_row_ptr)[i+1] += (*t_row_ptr)[i];
+    }
+    memcpy(next, *t_row_ptr, ((size_t) N + 1) * sizeof(nz_t));
+    for (int i = 0; i < M; i++) {
+        for (nz_t j = row_ptr[i]; j < row_ptr[i+1]; j++) {
+            nz_t k = next[col_idx[j]]++;
+            (*t_col_idx)[k] = i;
+            if (vals) {
+                (*t_vals)[k] = vals[j];
+            }
+        }
+    }
+    free(next);
+    return true;
+}
+
+void SpMV_csr_float(int M, nz_t *row_ptr, int *col_idx, float *vals, double *vector, double *result) {
+    // Values stored in float to reduce the matrix traffic, the accumulation stays in double
+    for (int i = 0; i < M; i++) {
+        double sum = 0.0;
+        for (nz_t j = row_ptr[i]; j < row_ptr[i+1]; j++) {
+            sum += (double) vals[j] * vector[col_idx[j]];
+        }
+        result[i] = sum;
+    }
+}
+
+void SpMV_csr_float_x(int M, nz_t *row_ptr, int *col_idx, float *vals, float *vector, double *result) {
+    // Both values and vector stored in float, the accumulation stays in double
+    for (int i = 0; i < M; i++) {
+        double sum = 0.0;
+        for (nz_t j = row_ptr[i]; j < row_ptr[i+1]; j++) {
+            sum += (double) vals[j] * (double) vector[col_idx[j]];
+        }
+        result[i] = sum;
+    }
+}
+
+bool double_to_float(nz_t n, double *in, float **out) {
+    *out = (float *) malloc((n > 0 ? n : 1) * sizeof(float));
+    if (!(*out)) {
+        fprintf(stderr, "Failed to allocate memory for float copy of %ld elements\n", (long) n);
+        fflush(stderr);
+        return false;
+    }
+    for (nz_t i = 0; i < n; i++) {
+        (*out)[i] = (float) in[i];
+    }
+    return true;
+}
+
+void compute_error(double *reference, double *result, int M, double *max_abs, double *relative) {
+    // Max absolute error and normwise relative error (infinity norm) against the reference
+    double max_ref = 0.0;
+    *max_abs = 0.0;
+    for (int i = 0; i < M; i++) {
+        double error = fabs(reference[i] - result[i]);
+        if (error > *max_abs) {
+            *max_abs = error;
+        }
+        if (fabs(reference[i]) > max_ref) {
+            max_ref = fabs(reference[i]);
+        }
+    }
+    *relative = (max_ref > 0.0) ? *max_abs / max_ref : *max_abs;
+}
+
 bool check_results(double *result_1, double *result_2, int M) {
-    double epsilon = 1e-6; // Tolerance for floating-point comparison
+    // Normwise tolerance: symmetric storage, reductions and reordering sum in another order,
+    // and with entries up to 1e10 and more the rounding differences exceed any absolute epsilon
+    double max_reference = 1.0;
+    for (int i = 0; i < M; i++) {
+        if (fabs(result_1[i]) > max_reference) {
+            max_reference = fabs(result_1[i]);
+        }
+    }
+    double epsilon = 1e-10 * max_reference; // Tolerance for floating-point comparison
     for (int i = 0; i < M; i++) {
         if (fabs(result_1[i] - result_2[i]) > epsilon) {
             printf("Mismatch at index %d: result_1=%f, result_2=%f\n", i, result_1[i], result_2[i]);
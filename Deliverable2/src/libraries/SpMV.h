@@ -2,8 +2,23 @@
 #define SPMV_H
 
 #include <stdbool.h>
+#include "index_types.h"
 
-void SpMV_csr(int M, int *row_ptr, int *col_idx, double *vals, double *vector, double *result);
+void SpMV_csr(int M, nz_t *row_ptr, int *col_idx, double *vals, double *vector, double *result);
+int sym_csr_reach(int M, int start_row, nz_t *row_ptr, int *col_idx);
+void SpMV_sym_csr(int M, int N, int start_row, nz_t *row_ptr, int *col_idx, double *vals, double *vector, double *result);
+void SpMV_csr_pattern(int M, nz_t *row_ptr, int *col_idx, double *vector, double *result);
+void SpMV_sym_csr_pattern(int M, int N, int start_row, nz_t *row_ptr, int *col_idx, double *vector, double *result);
+void SpMM_csr(int M, int k, nz_t *row_ptr, int *col_idx, double *vals, double *X, double *Y);
+bool block_to_columns(int n, int k, double *X, double **columns);
+void columns_to_block(int n, int k, double *columns, double *Y);
+void SpMV_csr_columns(int M, int N, int k, nz_t *row_ptr, int *col_idx, double *vals, double *x_columns, double *y_columns);
+void SpMV_csr_transpose(int M, int N, nz_t *row_ptr, int *col_idx, double *vals, double *vector, double *result);
+bool csr_transpose(int M, int N, nz_t *row_ptr, int *col_idx, double *vals, nz_t **t_row_ptr, int **t_col_idx, double **t_vals);
+void SpMV_csr_float(int M, nz_t *row_ptr, int *col_idx, float *vals, double *vector, double *result);
+void SpMV_csr_float_x(int M, nz_t *row_ptr, int *col_idx, float *vals, float *vector, double *result);
+bool double_to_float(nz_t n, double *in, float **out);
+void compute_error(double *reference, double *result, int M, double *max_abs, double *relative);
 bool check_results(double *result_1, double *result_2, int M);
 
 #endif
\ No newline at end of file
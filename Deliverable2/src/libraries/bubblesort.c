@@ -15,8 +15,8 @@ void swap_double(double *xp, double *yp) {
 }
 
 // An optimized version of Bubble Sort
-void bubbleSort(int *arr1, int *arr2, double *arr3, int n) {
-    int i, j;
+void bubbleSort(int *arr1, int *arr2, double *arr3, nz_t n) {
+    nz_t i, j;
     bool swapped;
     for (i = 0; i < n - 1; i++) {
         swapped = false;
@@ -24,7 +24,9 @@ void bubbleSort(int *arr1, int *arr2, double *arr3, int n) {
             if (arr1[j] > arr1[j + 1]) {
                 swap(&arr1[j], &arr1[j + 1]);
                 swap(&arr2[j], &arr2[j + 1]);
-                swap_double(&arr3[j], &arr3[j + 1]);
+                if (arr3) { // Pattern matrices have no values
+                    swap_double(&arr3[j], &arr3[j + 1]);
+                }
                 swapped = true;
             }
         }
@@ -1,8 +1,10 @@
 #ifndef BUBBLESORT_H
 #define BUBBLESORT_H
 
+#include "index_types.h"
+
 void swap(int *xp, int *yp);
 void swap_double(double *xp, double *yp);
-void bubbleSort(int *arr1, int *arr2, double *arr3, int n);
+void bubbleSort(int *arr1, int *arr2, double *arr3, nz_t n);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,96 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "complex_spmv.h"
+
+/*
+ * Complex CSR kernels, y = A x with complex A, x and y, in two layouts of the same data:
+ *  - interleaved: one array of (re, im) pairs, the layout of C99 double complex and of the file
+ *  - split: the real and imaginary parts in two arrays, four value/vector streams instead of two
+ * The products are written out in real arithmetic: the C99 complex multiplication checks every
+ * result for NaN and calls __muldc3 for the infinite cases unless -fcx-limited-range is given.
+ * The float kernels store the values in float (half the matrix traffic) and accumulate in double.
+ */
+
+void SpMV_csr_complex(int M, nz_t *row_ptr, int *col_idx, double *vals, double *vector, double *result) {
+    for (int i = 0; i < M; i++) {
+        double sum_re = 0.0, sum_im = 0.0;
+        for (nz_t j = row_ptr[i]; j < row_ptr[i+1]; j++) {
+            double a_re = vals[2 * (size_t) j], a_im = vals[2 * (size_t) j + 1];
+            double x_re = vector[2 * (size_t) col_idx[j]], x_im = vector[2 * (size_t) col_idx[j] + 1];
+            sum_re += a_re * x_re - a_im * x_im;
+            sum_im += a_re * x_im + a_im * x_re;
+        }
+        result[2 * (size_t) i] = sum_re;
+        result[2 * (size_t) i + 1] = sum_im;
+    }
+}
+
+void SpMV_csr_complex_split(int M, nz_t *row_ptr, int *col_idx, double *vals_re, double *vals_im,
+                            double *vector_re, double *vector_im, double *result_re, double *result_im) {
+    for (int i = 0; i < M; i++) {
+        double sum_re = 0.0, sum_im = 0.0;
+        for (nz_t j = row_ptr[i]; j < row_ptr[i+1]; j++) {
+            double x_re = vector_re[col_idx[j]], x_im = vector_im[col_idx[j]];
+            sum_re += vals_re[j] * x_re - vals_im[j] * x_im;
+            sum_im += vals_re[j] * x_im + vals_im[j] * x_re;
+        }
+        result_re[i] = sum_re;
+        result_im[i] = sum_im;
+    }
+}
+
+void SpMV_csr_complex_float(int M, nz_t *row_ptr, int *col_idx, float *vals, double *vector, double *result) {
+    for (int i = 0; i < M; i++) {
+        double sum_re = 0.0, sum_im = 0.0;
+        for (nz_t j = row_ptr[i]; j < row_ptr[i+1]; j++) {
+            double a_re = (double) vals[2 * (size_t) j], a_im = (double) vals[2 * (size_t) j + 1];
+            double x_re = vector[2 * (size_t) col_idx[j]], x_im = vector[2 * (size_t) col_idx[j] + 1];
+            sum_re += a_re * x_re - a_im * x_im;
+            sum_im += a_re * x_im + a_im * x_re;
+        }
+        result[2 * (size_t) i] = sum_re;
+        result[2 * (size_t) i + 1] = sum_im;
+    }
+}
+
+void SpMV_csr_complex_split_float(int M, nz_t *row_ptr, int *col_idx, float *vals_re, float *vals_im,
+                                  double *vector_re, double *vector_im, double *result_re, double *result_im) {
+    for (int i = 0; i < M; i++) {
+        double sum_re = 0.0, sum_im = 0.0;
+        for (nz_t j = row_ptr[i]; j < row_ptr[i+1]; j++) {
+            double a_re = (double) vals_re[j], a_im = (double) vals_im[j];
+            double x_re = vector_re[col_idx[j]], x_im = vector_im[col_idx[j]];
+            sum_re += a_re * x_re - a_im * x_im;
+            sum_im += a_re * x_im + a_im * x_re;
+        }
+        result_re[i] = sum_re;
+        result_im[i] = sum_im;
+    }
+}
+
+bool complex_to_split(nz_t n, double *in, double **re, double **im) {
+    // n complex elements, interleaved in "in"
+    *re = (double *) malloc((n > 0 ? n : 1) * sizeof(double));
+    *im = (double *) malloc((n > 0 ? n : 1) * sizeof(double));
+    if (!(*re) || !(*im)) {
+        fprintf(stderr, "Failed to allocate memory for split copy of %ld complex elements\n", (long) n);
+        fflush(stderr);
+        free(*re);
+        free(*im);
+        *re = NULL;
+        *im = NULL;
+        return false;
+    }
+    for (nz_t i = 0; i < n; i++) {
+        (*re)[i] = in[2 * (size_t) i];
+        (*im)[i] = in[2 * (size_t) i + 1];
+    }
+    return true;
+}
+
+void split_to_complex(nz_t n, double *re, double *im, double *out) {
+    for (nz_t i = 0; i < n; i++) {
+        out[2 * (size_t) i] = re[i];
+        out[2 * (size_t) i + 1] = im[i];
+    }
+}
@@ -0,0 +1,24 @@
+#ifndef CSB_H
+#define CSB_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "index_types.h"
+
+#define CSB_MAX_BETA 65536 // In-block indices are 16 bit
+
+int csb_default_beta(int M, int N);
+bool csr_to_csb(int M, int N, nz_t *row_ptr, int *col_idx, double *vals, int beta,
+                nz_t **blk_ptr, uint16_t **blk_row, uint16_t **blk_col, double **blk_vals);
+// One block row of y = A x (result rows bi*beta...) or one block column of y = A^T x (result rows bj*beta...),
+// the independent units of the parallel kernels
+void SpMV_csb_block_row(int bi, int M, int N, int beta, nz_t *blk_ptr, uint16_t *blk_row, uint16_t *blk_col, double *blk_vals,
+                        double *vector, double *result);
+void SpMV_csb_block_column(int bj, int M, int N, int beta, nz_t *blk_ptr, uint16_t *blk_row, uint16_t *blk_col, double *blk_vals,
+                           double *vector, double *result);
+void SpMV_csb(int M, int N, int beta, nz_t *blk_ptr, uint16_t *blk_row, uint16_t *blk_col, double *blk_vals,
+              double *vector, double *result);
+void SpMV_csb_transpose(int M, int N, int beta, nz_t *blk_ptr, uint16_t *blk_row, uint16_t *blk_col, double *blk_vals,
+                        double *vector, double *result);
+
+#endif
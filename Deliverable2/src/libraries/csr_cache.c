@@ -0,0 +1,178 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "csr_cache.h"
+
+/*
+ * Binary CSR cache of a Matrix Market file, mapped read-only by every process.
+ * The mapping is MAP_SHARED, so all the processes of a node use the same pages of
+ * the page cache instead of a private copy each. Layout:
+ *   int header[8]          magic, version, M, N, nz (low and high 32 bits), has values, bytes of nz_t
+ *   nz_t row_ptr[M+1]      global offsets, a row range is indexed without copying
+ *   int col_idx[nz]
+ *   double vals[nz]        only with values, aligned to 8 bytes
+ * The matrix is stored as the working processes keep it (symmetric storage for
+ * symmetric matrices, no values for pattern matrices, see read_matrix_to_csr_partial).
+ * A cache written by a build with another width of nz_t is rewritten.
+ */
+
+#define CSR_CACHE_MAGIC 0x31525343 // "CSR1"
+#define CSR_CACHE_VERSION 2
+#define CSR_CACHE_HEADER 8
+
+static size_t col_idx_offset(int M) {
+    return CSR_CACHE_HEADER * sizeof(int) + ((size_t) M + 1) * sizeof(nz_t);
+}
+
+static size_t vals_offset(int M, nz_t nz) {
+    size_t offset = col_idx_offset(M) + (size_t) nz * sizeof(int);
+    return (offset + 7) & ~(size_t) 7;
+}
+
+static bool header_is_valid(int *header) {
+    return header[0] == CSR_CACHE_MAGIC && header[1] == CSR_CACHE_VERSION && header[7] == (int) sizeof(nz_t);
+}
+
+bool csr_cache_is_fresh(char *filename, char *cache_name) {
+    // The cache is used only if it is newer than the matrix file, and has the same layout
+    struct stat matrix_stat, cache_stat;
+    if (stat(filename, &matrix_stat) != 0 || stat(cache_name, &cache_stat) != 0) {
+        return false;
+    }
+    int header[CSR_CACHE_HEADER];
+    FILE *f = fopen(cache_name, "rb");
+    if (!f) {
+        return false;
+    }
+    bool valid = fread(header, sizeof(int), CSR_CACHE_HEADER, f) == CSR_CACHE_HEADER && header_is_valid(header);
+    fclose(f);
+    return valid && cache_stat.st_mtime >= matrix_stat.st_mtime;
+}
+
+bool write_csr_cache(char *cache_name, int M, int N, nz_t nz, nz_t *row_ptr, int *col_idx, double *vals) {
+    // Written to a temporary file and renamed, so a process never maps a partial cache
+    char tmp_name[512];
+    snprintf(tmp_name, sizeof(tmp_name), "%s.tmp", cache_name);
+    FILE *f = fopen(tmp_name, "wb");
+    if (!f) {
+        fprintf(stderr, "Failed to create the CSR cache: %s\n", tmp_name);
+        fflush(stderr);
+        return false;
+    }
+
+    uint64_t nz_64 = (uint64_t) nz;
+    int header[CSR_CACHE_HEADER] = {CSR_CACHE_MAGIC, CSR_CACHE_VERSION, M, N, (int) (uint32_t) nz_64, (int) (uint32_t) (nz_64 >> 32),
+                                    vals ? 1 : 0, (int) sizeof(nz_t)};
+    bool ok = fwrite(header, sizeof(int), CSR_CACHE_HEADER, f) == CSR_CACHE_HEADER
+              && fwrite(row_ptr, sizeof(nz_t), (size_t) M + 1, f) == (size_t) M + 1
+              && fwrite(col_idx, sizeof(int), (size_t) nz, f) == (size_t) nz;
+    if (ok && vals) {
+        size_t written = col_idx_offset(M) + (size_t) nz * sizeof(int);
+        char padding[8] = {0};
+        ok = fwrite(padding, 1, vals_offset(M, nz) - written, f) == vals_offset(M, nz) - written
+             && fwrite(vals, sizeof(double), (size_t) nz, f) == (size_t) nz;
+    }
+    if (fclose(f) != 0) {
+        ok = false;
+    }
+    if (!ok || rename(tmp_name, cache_name) != 0) {
+        fprintf(stderr, "Failed to write the CSR cache: %s\n", cache_name);
+        fflush(stderr);
+        remove(tmp_name);
+        return false;
+    }
+    return true;
+}
+
+bool map_csr_cache(char *cache_name, bool populate, void **map, size_t *map_size, int *M, int *N, nz_t *nz, nz_t **row_ptr, int **col_idx, double **vals) {
+    // With populate the pages are read in at mapping time (MAP_POPULATE), instead of
+    // faulting in during the first product
+    int fd = open(cache_name, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to open the CSR cache: %s\n", cache_name);
+        fflush(stderr);
+        return false;
+    }
+    struct stat cache_stat;
+    if (fstat(fd, &cache_stat) != 0 || (size_t) cache_stat.st_size < CSR_CACHE_HEADER * sizeof(int)) {
+        fprintf(stderr, "Invalid CSR cache: %s\n", cache_name);
+        fflush(stderr);
+        close(fd);
+        return false;
+    }
+
+    int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+    if (populate) {
+        flags |= MAP_POPULATE;
+    }
+#endif
+    *map_size = (size_t) cache_stat.st_size;
+    *map = mmap(NULL, *map_size, PROT_READ, flags, fd, 0);
+    close(fd); // The mapping keeps the file open
+    if (*map == MAP_FAILED) {
+        fprintf(stderr, "Failed to map the CSR cache: %s\n", cache_name);
+        fflush(stderr);
+        *map = NULL;
+        return false;
+    }
+#ifdef MADV_HUGEPAGE
+    if (populate) {
+        madvise(*map, *map_size, MADV_HUGEPAGE); // Only a hint, ignored where file pages cannot be huge
+    }
+#endif
+
+    int *header = (int *) *map;
+    *M = header[2];
+    *N = header[3];
+    *nz = (nz_t) ((uint64_t) (uint32_t) header[4] | ((uint64_t) (uint32_t) header[5] << 32));
+    size_t expected = header[6] ? vals_offset(*M, *nz) + (size_t) *nz * sizeof(double)
+                                : col_idx_offset(*M) + (size_t) *nz * sizeof(int);
+    if (!header_is_valid(header) || expected > *map_size) {
+        fprintf(stderr, "Invalid CSR cache: %s\n", cache_name);
+        fflush(stderr);
+        unmap_csr_cache(*map, *map_size);
+        *map = NULL;
+        return false;
+    }
+    *row_ptr = (nz_t *) (header + CSR_CACHE_HEADER);
+    *col_idx = (int *) ((char *) *map + col_idx_offset(*M));
+    *vals = header[6] ? (double *) ((char *) *map + vals_offset(*M, *nz)) : NULL;
+    return true;
+}
+
+void unmap_csr_cache(void *map, size_t map_size) {
+    if (map) {
+        munmap(map, map_size);
+    }
+}
+
+bool read_csr_cache_layout(char *cache_name, int *M, int *N, nz_t *nz, bool *has_vals, size_t *col_idx_start, size_t *vals_start) {
+    // Sizes and byte offsets of the arrays, for the processes that read the cache instead of mapping it
+    int header[CSR_CACHE_HEADER];
+    FILE *f = fopen(cache_name, "rb");
+    if (!f) {
+        fprintf(stderr, "Failed to open the CSR cache: %s\n", cache_name);
+        fflush(stderr);
+        return false;
+    }
+    bool valid = fread(header, sizeof(int), CSR_CACHE_HEADER, f) == CSR_CACHE_HEADER && header_is_valid(header);
+    fclose(f);
+    if (!valid) {
+        fprintf(stderr, "Invalid CSR cache: %s\n", cache_name);
+        fflush(stderr);
+        return false;
+    }
+    *M = header[2];
+    *N = header[3];
+    *nz = (nz_t) ((uint64_t) (uint32_t) header[4] | ((uint64_t) (uint32_t) header[5] << 32));
+    *has_vals = header[6] != 0;
+    *col_idx_start = col_idx_offset(*M);
+    *vals_start = vals_offset(*M, *nz);
+    return true;
+}
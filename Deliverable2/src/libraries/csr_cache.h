@@ -0,0 +1,14 @@
+#ifndef CSR_CACHE_H
+#define CSR_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "index_types.h"
+
+bool csr_cache_is_fresh(char *filename, char *cache_name);
+bool write_csr_cache(char *cache_name, int M, int N, nz_t nz, nz_t *row_ptr, int *col_idx, double *vals);
+bool map_csr_cache(char *cache_name, bool populate, void **map, size_t *map_size, int *M, int *N, nz_t *nz, nz_t **row_ptr, int **col_idx, double **vals);
+void unmap_csr_cache(void *map, size_t map_size);
+bool read_csr_cache_layout(char *cache_name, int *M, int *N, nz_t *nz, bool *has_vals, size_t *col_idx_start, size_t *vals_start);
+
+#endif
@@ -0,0 +1,206 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "csr_du.h"
+
+/*
+ * CSR-DU: the column indices of each row are stored as the gaps between consecutive columns
+ * (the first one from column 0), packed in "units" inside the ctl stream.
+ * Each unit starts with a header byte:
+ *   bits 7-6: width of the deltas in the unit (0 = 8 bit, 1 = 16 bit, 2 = 32 bit escape for large jumps,
+ *             3 = no deltas, the unit stands for a run of empty rows)
+ *   bit 5:    the unit starts a new row
+ *   bits 4-0: number of deltas (or empty rows) in the unit minus 1 (up to 32)
+ * followed by the deltas themselves. The stream covers every row in order, so the kernel
+ * needs neither row_ptr nor per-row offsets: the values are consumed in CSR order.
+ */
+
+#define DU_MAX_UNIT 32
+#define DU_NEW_ROW 0x20
+#define DU_COUNT_MASK 0x1F
+#define DU_EMPTY_ROWS 3
+
+static int delta_width(int delta) {
+    if (delta <= UINT8_MAX) {
+        return 0;
+    }
+    if (delta <= UINT16_MAX) {
+        return 1;
+    }
+    return 2;
+}
+
+static void sort_row_columns(nz_t start, nz_t end, int *col_idx, double *vals) {
+    // Deltas must be non-negative, so columns are sorted inside each row (insertion sort, rows are short)
+    for (nz_t j = start + 1; j < end; j++) {
+        int col = col_idx[j];
+        double val = vals[j];
+        nz_t k = j - 1;
+        while (k >= start && col_idx[k] > col) {
+            col_idx[k+1] = col_idx[k];
+            vals[k+1] = vals[k];
+            k--;
+        }
+        col_idx[k+1] = col;
+        vals[k+1] = val;
+    }
+}
+
+static int column_delta(nz_t start, nz_t j, int *col_idx) {
+    return (j == start) ? col_idx[j] : col_idx[j] - col_idx[j-1];
+}
+
+// Encode the units of one non-empty row, or only count the bytes if out is NULL
+static nz_t encode_row(nz_t start, nz_t end, int *col_idx, uint8_t *out) {
+    nz_t size = 0;
+    nz_t j = start;
+
+    while (j < end) {
+        int width = delta_width(column_delta(start, j, col_idx));
+        int count = 1;
+        // Extend the unit while the next deltas need the same width
+        while (j + count < end && count < DU_MAX_UNIT
+               && delta_width(column_delta(start, j + count, col_idx)) == width) {
+            count++;
+        }
+
+        if (out) {
+            out[size] = (uint8_t) ((width << 6) | (j == start ? DU_NEW_ROW : 0) | (count - 1));
+        }
+        size++;
+
+        for (int k = 0; k < count; k++) {
+            uint32_t delta = (uint32_t) column_delta(start, j + k, col_idx);
+            if (width == 0) {
+                if (out) {
+                    out[size] = (uint8_t) delta;
+                }
+                size += 1;
+            } else if (width == 1) {
+                if (out) {
+                    uint16_t d16 = (uint16_t) delta;
+                    memcpy(&out[size], &d16, sizeof(uint16_t));
+                }
+                size += 2;
+            } else {
+                if (out) {
+                    memcpy(&out[size], &delta, sizeof(uint32_t));
+                }
+                size += 4;
+            }
+        }
+        j += count;
+    }
+
+    return size;
+}
+
+// Encode runs of empty rows, or only count the bytes if out is NULL
+static nz_t encode_empty_rows(int rows, uint8_t *out) {
+    nz_t size = 0;
+    while (rows > 0) {
+        int count = (rows < DU_MAX_UNIT) ? rows : DU_MAX_UNIT;
+        if (out) {
+            out[size] = (uint8_t) ((DU_EMPTY_ROWS << 6) | DU_NEW_ROW | (count - 1));
+        }
+        size++;
+        rows -= count;
+    }
+    return size;
+}
+
+// Encode all the rows, or only count the bytes if out is NULL
+static nz_t encode_rows(int M, nz_t *row_ptr, int *col_idx, uint8_t *out) {
+    nz_t size = 0;
+    int i = 0;
+    while (i < M) {
+        if (row_ptr[i] == row_ptr[i+1]) {
+            int empty = 1;
+            while (i + empty < M && row_ptr[i+empty] == row_ptr[i+empty+1]) {
+                empty++;
+            }
+            size += encode_empty_rows(empty, out ? out + size : NULL);
+            i += empty;
+        } else {
+            size += encode_row(row_ptr[i], row_ptr[i+1], col_idx, out ? out + size : NULL);
+            i++;
+        }
+    }
+    return size;
+}
+
+bool csr_to_csr_du(int M, nz_t *row_ptr, int *col_idx, double *vals, uint8_t **ctl, nz_t *ctl_size) {
+    /* Count the size of the ctl stream */
+    for (int i = 0; i < M; i++) {
+        sort_row_columns(row_ptr[i], row_ptr[i+1], col_idx, vals);
+    }
+    *ctl_size = encode_rows(M, row_ptr, col_idx, NULL);
+
+    /* Fill the ctl stream */
+    *ctl = (uint8_t *) malloc((*ctl_size > 0 ? *ctl_size : 1) * sizeof(uint8_t));
+    if (!(*ctl)) {
+        fprintf(stderr, "Failed to allocate memory for CSR-DU ctl stream (%ld bytes)\n", (long) *ctl_size);
+        fflush(stderr);
+        return false;
+    }
+    encode_rows(M, row_ptr, col_idx, *ctl);
+
+    return true;
+}
+
+void SpMV_csr_du(uint8_t *ctl, nz_t ctl_size, double *vals, double *vector, double *result) {
+    const uint8_t *p = ctl;
+    const uint8_t *end = ctl + ctl_size;
+    int i = -1; // Current row, the first unit always starts a new one
+    int col = 0;
+    nz_t j = 0;
+    double sum = 0.0;
+
+    while (p < end) {
+        int width = *p >> 6;
+        int count = (*p & DU_COUNT_MASK) + 1;
+        if (*p & DU_NEW_ROW) {
+            if (i >= 0) {
+                result[i] = sum;
+            }
+            i++;
+            col = 0;
+            sum = 0.0;
+        }
+        p++;
+
+        if (width == DU_EMPTY_ROWS) {
+            // The last empty row stays current and is stored with the next new row
+            for (int k = 0; k < count - 1; k++) {
+                result[i++] = 0.0;
+            }
+        } else if (width == 0) {
+            for (int k = 0; k < count; k++) {
+                col += p[k];
+                sum += vals[j++] * vector[col];
+            }
+            p += count;
+        } else if (width == 1) {
+            for (int k = 0; k < count; k++) {
+                uint16_t d16;
+                memcpy(&d16, p, sizeof(uint16_t));
+                p += 2;
+                col += d16;
+                sum += vals[j++] * vector[col];
+            }
+        } else {
+            for (int k = 0; k < count; k++) {
+                uint32_t d32;
+                memcpy(&d32, p, sizeof(uint32_t));
+                p += 4;
+                col += (int) d32;
+                sum += vals[j++] * vector[col];
+            }
+        }
+    }
+    if (i >= 0) {
+        result[i] = sum;
+    }
+}
@@ -0,0 +1,11 @@
+#ifndef CSR_DU_H
+#define CSR_DU_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "index_types.h"
+
+bool csr_to_csr_du(int M, nz_t *row_ptr, int *col_idx, double *vals, uint8_t **ctl, nz_t *ctl_size);
+void SpMV_csr_du(uint8_t *ctl, nz_t ctl_size, double *vals, double *vector, double *result);
+
+#endif
@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "csr_vi.h"
+
+/*
+ * Value-indexed CSR: the values are replaced by a dictionary of the distinct values
+ * and one 8 or 16 bit code per non-zero, row_ptr and col_idx are the same as CSR.
+ */
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+// Sorted copy of the values, the distinct ones are then the runs of equal elements
+static double *sorted_copy(nz_t nz, double *vals) {
+    double *sorted = (double *) malloc((nz > 0 ? nz : 1) * sizeof(double));
+    if (!sorted) {
+        return NULL;
+    }
+    memcpy(sorted, vals, nz * sizeof(double));
+    qsort(sorted, nz, sizeof(double), compare_doubles);
+    return sorted;
+}
+
+int count_distinct_values(nz_t nz, double *vals, int limit) {
+    // Returns limit+1 as soon as there are more than limit distinct values (or on allocation failure)
+    double *sorted = sorted_copy(nz, vals);
+    if (!sorted) {
+        return limit + 1;
+    }
+
+    int distinct = (nz > 0) ? 1 : 0;
+    for (nz_t i = 1; i < nz && distinct <= limit; i++) {
+        if (sorted[i] != sorted[i-1]) {
+            distinct++;
+        }
+    }
+
+    free(sorted);
+    return distinct;
+}
+
+bool csr_vi_is_worth(nz_t nz, int distinct) {
+    // The dictionary is read at random, so it must be smaller than the bytes saved on the values
+    if (distinct > VI_MAX_DICT) {
+        return false;
+    }
+    int code_bytes = (distinct <= 256) ? 1 : 2;
+    return (long) distinct * sizeof(double) < (long) nz * (sizeof(double) - code_bytes);
+}
+
+bool csr_to_csr_vi(nz_t nz, double *vals, double **dict, int *dict_size, void **codes, int *code_bytes) {
+    double *sorted = sorted_copy(nz, vals);
+    if (!sorted) {
+        fprintf(stderr, "Failed to allocate memory for the value dictionary\n");
+        fflush(stderr);
+        return false;
+    }
+
+    /* Build the dictionary from the sorted values */
+    nz_t distinct = 0;
+    for (nz_t i = 0; i < nz; i++) {
+        if (i == 0 || sorted[i] != sorted[distinct-1]) {
+            sorted[distinct] = sorted[i];
+            distinct++;
+        }
+    }
+    if (distinct > VI_MAX_DICT) {
+        fprintf(stderr, "Too many distinct values for the value dictionary: %ld\n", (long) distinct);
+        fflush(stderr);
+        free(sorted);
+        return false;
+    }
+    *dict = (double *) realloc(sorted, (distinct > 0 ? distinct : 1) * sizeof(double));
+    if (!(*dict)) {
+        free(sorted);
+        return false;
+    }
+    *dict_size = (int) distinct;
+    *code_bytes = (distinct <= 256) ? 1 : 2;
+
+    *codes = malloc((nz > 0 ? nz : 1) * (*code_bytes));
+    if (!(*codes)) {
+        fprintf(stderr, "Failed to allocate memory for the value codes\n");
+        fflush(stderr);
+        free(*dict);
+        *dict = NULL;
+        return false;
+    }
+
+    /* Replace each value with its position in the dictionary */
+    for (nz_t i = 0; i < nz; i++) {
+        int low = 0;
+        int high = (int) distinct - 1;
+        while (low < high) { // Binary search, the value is always present
+            int mid = (low + high) / 2;
+            if ((*dict)[mid] < vals[i]) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        if (*code_bytes == 1) {
+            ((uint8_t *) *codes)[i] = (uint8_t) low;
+        } else {
+            ((uint16_t *) *codes)[i] = (uint16_t) low;
+        }
+    }
+
+    return true;
+}
+
+void SpMV_csr_vi8(int M, nz_t *row_ptr, int *col_idx, double *dict, uint8_t *codes, double *vector, double *result) {
+    for (int i = 0; i < M; i++) { // Loop over local rows
+        double sum = 0.0;
+        for (nz_t j = row_ptr[i]; j < row_ptr[i+1]; j++) {
+            sum += dict[codes[j]] * vector[col_idx[j]];
+        }
+        result[i] = sum;
+    }
+}
+
+void SpMV_csr_vi16(int M, nz_t *row_ptr, int *col_idx, double *dict, uint16_t *codes, double *vector, double *result) {
+    for (int i = 0; i < M; i++) { // Loop over local rows
+        double sum = 0.0;
+        for (nz_t j = row_ptr[i]; j < row_ptr[i+1]; j++) {
+            sum += dict[codes[j]] * vector[col_idx[j]];
+        }
+        result[i] = sum;
+    }
+}
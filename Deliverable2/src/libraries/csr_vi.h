@@ -0,0 +1,16 @@
+#ifndef CSR_VI_H
+#define CSR_VI_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "index_types.h"
+
+#define VI_MAX_DICT 65536 // Largest dictionary addressable with 16 bit codes
+
+int count_distinct_values(nz_t nz, double *vals, int limit);
+bool csr_vi_is_worth(nz_t nz, int distinct);
+bool csr_to_csr_vi(nz_t nz, double *vals, double **dict, int *dict_size, void **codes, int *code_bytes);
+void SpMV_csr_vi8(int M, nz_t *row_ptr, int *col_idx, double *dict, uint8_t *codes, double *vector, double *result);
+void SpMV_csr_vi16(int M, nz_t *row_ptr, int *col_idx, double *dict, uint16_t *codes, double *vector, double *result);
+
+#endif
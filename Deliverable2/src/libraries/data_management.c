@@ -60,4 +60,20 @@ int find_max_M(int *row_dist, int processes) {
     }
 
     return max_M;
-}
\ No newline at end of file
+}
+
+int find_block(int *dist, int blocks, int index) {
+    int low = 0, high = blocks - 1;
+
+    // Binary search for the block with dist[block] <= index < dist[block+1]
+    while (low < high) {
+        int mid = (low + high + 1) / 2;
+        if (dist[mid] <= index) {
+            low = mid;
+        } else {
+            high = mid - 1;
+        }
+    }
+
+    return low;
+}
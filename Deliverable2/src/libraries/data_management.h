@@ -5,5 +5,6 @@ double compute_avg(int num_iterations, double *time);
 int find_outlier(int num_iterations, double *time, double avg);
 void remove_outlier(int num_iterations, double *time, double *avg_time);
 int find_max_M(int *row_dist, int processes);
+int find_block(int *dist, int blocks, int index);
 
 #endif
\ No newline at end of file
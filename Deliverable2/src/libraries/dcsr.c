@@ -0,0 +1,70 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "dcsr.h"
+
+/*
+ * Doubly compressed CSR: only the rows with at least one entry are kept, row_ids[r] is the local
+ * row of the r-th of them and dcsr_ptr[r] .. dcsr_ptr[r+1]-1 its entries in the col_idx and vals
+ * of the CSR, which are shared and not copied. With many processes a block of rows of a large
+ * matrix can be mostly empty, and then the row pointers and the loop over every row of SpMV_csr
+ * cost more than the non-zeros; here the loop only visits the non-empty rows and scatters their
+ * sums into the result, cleared beforehand.
+ */
+
+int count_nonempty_rows(int M, nz_t *row_ptr) {
+    int count = 0;
+    for (int i = 0; i < M; i++) {
+        if (row_ptr[i+1] > row_ptr[i]) {
+            count++;
+        }
+    }
+    return count;
+}
+
+bool dcsr_is_worth(int M, int nonempty_rows) {
+    return M > 0 && (double) (M - nonempty_rows) / M > DCSR_MIN_EMPTY_FRACTION;
+}
+
+bool csr_to_dcsr(int M, nz_t *row_ptr, int nonempty_rows, int **row_ids, nz_t **dcsr_ptr) {
+    *row_ids = (int *) malloc(((size_t) nonempty_rows + 1) * sizeof(int));
+    *dcsr_ptr = (nz_t *) malloc(((size_t) nonempty_rows + 1) * sizeof(nz_t));
+    if (!(*row_ids) || !(*dcsr_ptr)) {
+        fprintf(stderr, "Failed to allocate memory for the DCSR rows (%d non-empty rows)\n", nonempty_rows);
+        fflush(stderr);
+        free(*row_ids);
+        free(*dcsr_ptr);
+        *row_ids = NULL;
+        *dcsr_ptr = NULL;
+        return false;
+    }
+    int r = 0;
+    for (int i = 0; i < M; i++) {
+        if (row_ptr[i+1] > row_ptr[i]) {
+            (*row_ids)[r] = i;
+            (*dcsr_ptr)[r] = row_ptr[i];
+            r++;
+        }
+    }
+    (*dcsr_ptr)[r] = row_ptr[M]; // Same offsets as row_ptr, also for the rows of a mapped cache
+    return true;
+}
+
+void SpMV_dcsr(int M, int nonempty_rows, int *row_ids, nz_t *dcsr_ptr, int *col_idx, double *vals, double *vector, double *result) {
+    // vals is NULL for pattern matrices
+    memset(result, 0, (size_t) M * sizeof(double));
+    for (int r = 0; r < nonempty_rows; r++) {
+        double sum = 0.0;
+        if (vals) {
+            for (nz_t j = dcsr_ptr[r]; j < dcsr_ptr[r+1]; j++) {
+                sum += vals[j] * vector[col_idx[j]];
+            }
+        } else {
+            for (nz_t j = dcsr_ptr[r]; j < dcsr_ptr[r+1]; j++) {
+                sum += vector[col_idx[j]];
+            }
+        }
+        result[row_ids[r]] = sum;
+    }
+}
@@ -0,0 +1,14 @@
+#ifndef DCSR_H
+#define DCSR_H
+
+#include <stdbool.h>
+#include "index_types.h"
+
+#define DCSR_MIN_EMPTY_FRACTION 0.5 // Empty rows over local rows above which DCSR is used
+
+int count_nonempty_rows(int M, nz_t *row_ptr);
+bool dcsr_is_worth(int M, int nonempty_rows);
+bool csr_to_dcsr(int M, nz_t *row_ptr, int nonempty_rows, int **row_ids, nz_t **dcsr_ptr);
+void SpMV_dcsr(int M, int nonempty_rows, int *row_ids, nz_t *dcsr_ptr, int *col_idx, double *vals, double *vector, double *result);
+
+#endif
@@ -0,0 +1,201 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include "fast_parse.h"
+#include "fast_parse_table.h"
+
+/*
+ * Parsers for the entries of Matrix Market files, in place of strtol and strtod
+ * (no locale, errno or base handling, the digits are accumulated directly).
+ * A double is read as a mantissa w of up to 19 significant digits and a decimal exponent q:
+ *  - w <= 2^53 and |q| <= 22: w and 10^q are exact doubles, one multiplication or division
+ *    rounds correctly (Clinger's fast path)
+ *  - otherwise w * 5^q is computed with the 128-bit table and rounded to nearest even
+ *    (Eisel-Lemire, as in the fast_float library)
+ * More digits, inf, nan and the rare ambiguous products go to strtod, so the result is
+ * always the correctly rounded double, bit for bit the one of strtod.
+ */
+
+#define IS_DIGIT(c) ((unsigned) ((c) - '0') < 10)
+#define MANTISSA_BITS 52
+#define EXPONENT_BIAS 1023
+#define INFINITY_BITS 0x7FF0000000000000ULL
+
+static const double exact_powers_of_ten[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                             1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+char *parse_int(char *p, int *value) {
+    char *start = p;
+    while (*p == ' ' || *p == '\t') {
+        p++;
+    }
+    bool negative = *p == '-';
+    if (*p == '-' || *p == '+') {
+        p++;
+    }
+    char *digits = p;
+    unsigned int v = 0;
+    while (IS_DIGIT(*p)) {
+        v = v * 10 + (unsigned int) (*p - '0');
+        p++;
+    }
+    if (p == digits) { // No number, like strtol
+        *value = 0;
+        return start;
+    }
+    *value = negative ? -(int) v : (int) v;
+    return p;
+}
+
+static bool eisel_lemire(uint64_t w, int64_t q, uint64_t *bits) {
+    // Bits of the double nearest to w * 10^q, w != 0; false when the product cannot decide the rounding
+    if (q < POWER_OF_FIVE_MIN) {
+        *bits = 0;
+        return true;
+    }
+    if (q > POWER_OF_FIVE_MAX) {
+        *bits = INFINITY_BITS;
+        return true;
+    }
+    int lz = __builtin_clzll(w);
+    w <<= lz;
+
+    // Upper 128 bits of w * 5^q, the second word only when the first cannot give 55 exact bits
+    int index = 2 * (int) (q - POWER_OF_FIVE_MIN);
+    unsigned __int128 product = (unsigned __int128) w * power_of_five_128[index];
+    uint64_t high = (uint64_t) (product >> 64), low = (uint64_t) product;
+    const uint64_t precision_mask = UINT64_MAX >> (MANTISSA_BITS + 3);
+    if ((high & precision_mask) == precision_mask) {
+        uint64_t second = (uint64_t) (((unsigned __int128) w * power_of_five_128[index + 1]) >> 64);
+        low += second;
+        if (second > low) {
+            high++;
+        }
+    }
+    if (low == UINT64_MAX && (q < -27 || q > 55)) {
+        return false;
+    }
+
+    int upper_bit = (int) (high >> 63);
+    int shift = upper_bit + 64 - MANTISSA_BITS - 3;
+    uint64_t mantissa = high >> shift;
+    // floor(q * log2(10)) + 63 with a fixed point constant, plus the normalisation shifts
+    int32_t power2 = (int32_t) ((((152170 + 65536) * q) >> 16) + 63) + upper_bit - lz + EXPONENT_BIAS;
+
+    if (power2 <= 0) { // Subnormal
+        if (-power2 + 1 >= 64) {
+            *bits = 0;
+            return true;
+        }
+        mantissa >>= -power2 + 1;
+        mantissa += mantissa & 1;
+        mantissa >>= 1;
+        power2 = (mantissa < (1ULL << MANTISSA_BITS)) ? 0 : 1;
+        *bits = mantissa | ((uint64_t) power2 << MANTISSA_BITS);
+        return true;
+    }
+
+    // Exactly halfway (only possible when 5^q fits in 64 bits): round to even
+    if (low <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1 && (mantissa << shift) == high) {
+        mantissa &= ~1ULL;
+    }
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if (mantissa >= (2ULL << MANTISSA_BITS)) {
+        mantissa = 1ULL << MANTISSA_BITS;
+        power2++;
+    }
+    mantissa &= ~(1ULL << MANTISSA_BITS);
+    *bits = (power2 >= 0x7FF) ? INFINITY_BITS : mantissa | ((uint64_t) power2 << MANTISSA_BITS);
+    return true;
+}
+
+char *parse_double(char *p, double *value) {
+    char *start = p, *end;
+    while (*p == ' ' || *p == '\t') {
+        p++;
+    }
+    bool negative = *p == '-';
+    if (*p == '-' || *p == '+') {
+        p++;
+    }
+
+    /* Mantissa digits, the leading zeros are not significant */
+    uint64_t w = 0;
+    int digits = 0;
+    int64_t exponent = 0;
+    bool any_digit = false;
+    while (*p == '0') {
+        p++;
+        any_digit = true;
+    }
+    while (IS_DIGIT(*p)) {
+        w = w * 10 + (uint64_t) (*p - '0'); // Wraps past 19 digits, those go to strtod below
+        digits++;
+        p++;
+        any_digit = true;
+    }
+    if (*p == '.') {
+        p++;
+        if (digits == 0) {
+            while (*p == '0') {
+                exponent--;
+                p++;
+                any_digit = true;
+            }
+        }
+        while (IS_DIGIT(*p)) {
+            w = w * 10 + (uint64_t) (*p - '0');
+            digits++;
+            exponent--;
+            p++;
+            any_digit = true;
+        }
+    }
+    if (!any_digit) { // inf, nan or no number
+        *value = strtod(start, &end);
+        return end;
+    }
+
+    /* Exponent, only if followed by digits */
+    if (*p == 'e' || *p == 'E') {
+        char *e = p + 1;
+        bool exponent_negative = *e == '-';
+        if (*e == '-' || *e == '+') {
+            e++;
+        }
+        if (IS_DIGIT(*e)) {
+            int64_t e_value = 0;
+            while (IS_DIGIT(*e)) {
+                if (e_value < 100000) { // Far beyond the range of doubles already
+                    e_value = e_value * 10 + (*e - '0');
+                }
+                e++;
+            }
+            exponent += exponent_negative ? -e_value : e_value;
+            p = e;
+        }
+    }
+
+    if (digits > 19) {
+        *value = strtod(start, &end);
+        return end;
+    }
+    double d;
+    if (w == 0) {
+        d = 0.0;
+    } else if (exponent >= -22 && exponent <= 22 && w <= (1ULL << 53)) {
+        d = (double) w;
+        d = (exponent < 0) ? d / exact_powers_of_ten[-exponent] : d * exact_powers_of_ten[exponent];
+    } else {
+        uint64_t bits;
+        if (!eisel_lemire(w, exponent, &bits)) {
+            *value = strtod(start, &end);
+            return end;
+        }
+        memcpy(&d, &bits, sizeof(d));
+    }
+    *value = negative ? -d : d;
+    return p;
+}
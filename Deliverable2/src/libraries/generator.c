@@ -5,67 +5,161 @@
 #include "generator.h"
 #include "bubblesort.h"
 
-bool generate_matrix(int rows, int cols, int percent_nonzero, int **I, int **J, double **vals, int *nz) {
-    int total = rows * cols;
-    uint8_t *mask = malloc(total); // Keep track of filled positions
-    if (!mask) {
-        fprintf(stderr, "Mask allocation failed\n");
-        return false;
+/*
+ * Philox4x32-10 counter-based random number generator (Salmon et al., SC'11):
+ * the output is a pure function of (counter, key), so any entry of the matrix
+ * can be generated independently, by any process, in any order.
+ */
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+#define PHILOX_ROUNDS 10
+
+void philox4x32(const uint32_t counter[4], uint64_t seed, uint32_t out[4]) {
+    uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+    uint32_t k0 = (uint32_t) seed, k1 = (uint32_t) (seed >> 32);
+
+    for (int round = 0; round < PHILOX_ROUNDS; round++) {
+        uint64_t p0 = (uint64_t) PHILOX_M0 * c0;
+        uint64_t p1 = (uint64_t) PHILOX_M1 * c2;
+        c0 = (uint32_t) (p1 >> 32) ^ c1 ^ k0;
+        c1 = (uint32_t) p1;
+        c2 = (uint32_t) (p0 >> 32) ^ c3 ^ k1;
+        c3 = (uint32_t) p0;
+        k0 += PHILOX_W0; // Bump the key between rounds
+        k1 += PHILOX_W1;
     }
-    int local_nz = 0;
 
-    /* Count non-zero elements (no need to have the real matrix in memory) */
-    for (int k = 0; k < total; ++k) {
-        if ((rand() % 100) < percent_nonzero) {
-            mask[k] = 1; // 1 if non-zero 
-            local_nz++; // Increment count if non-zero
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+/*
+ * Geometric skips: with density p, the number of zeros before the next non-zero of a row is
+ * S with P(S >= s) = (1-p)^s, sampled as the largest s with (1-p)^s >= u for u uniform in (0, 1].
+ * The powers are tabulated (no libm needed), longer skips use the memoryless property:
+ * if u < (1-p)^K, then S - K has the same distribution and u / (1-p)^K is uniform again.
+ */
+#define SKIP_TABLE 1024
+
+static void build_skip_table(int percent_nonzero, double *table) {
+    double q = 1.0 - percent_nonzero / 100.0;
+    table[0] = 1.0;
+    for (int s = 0; s < SKIP_TABLE; s++) {
+        table[s+1] = table[s] * q;
+    }
+}
+
+static long geometric_skip(double *table, double u) {
+    long skip = 0;
+    while (u < table[SKIP_TABLE] && table[SKIP_TABLE] > 0.0) {
+        skip += SKIP_TABLE;
+        u /= table[SKIP_TABLE];
+    }
+    int low = 0, high = SKIP_TABLE; // Largest s with table[s] >= u
+    while (low < high) {
+        int mid = (low + high + 1) / 2;
+        if (table[mid] >= u) {
+            low = mid;
         } else {
-            mask[k] = 0; // 0 otherwise
+            high = mid - 1;
+        }
+    }
+    return skip + low;
+}
+
+static bool grow_arrays(long capacity, int **I, int **J, double **vals) {
+    // The arrays keep their content if one of them cannot grow, the caller frees them
+    if (I) {
+        int *new_I = (int *) realloc(*I, capacity * sizeof(int));
+        if (!new_I) {
+            fprintf(stderr, "Allocation failed while growing the matrix\n");
+            fflush(stderr);
+            return false;
         }
-        
+        *I = new_I;
     }
+    int *new_J = (int *) realloc(*J, capacity * sizeof(int));
+    if (new_J) {
+        *J = new_J;
+    }
+    double *new_vals = (double *) realloc(*vals, capacity * sizeof(double));
+    if (new_vals) {
+        *vals = new_vals;
+    }
+    if (!new_J || !new_vals) {
+        fprintf(stderr, "Allocation failed while growing the matrix\n");
+        fflush(stderr);
+        return false;
+    }
+    return true;
+}
 
-    *nz = local_nz;
+bool generate_matrix(int rows, int cols, int percent_nonzero, int **I, int **J, double **vals, nz_t *nz) {
+    // Non-zero positions are sampled row by row with geometric skips, so the time and memory
+    // are O(nz) instead of O(rows * cols), and the entries come out sorted by row and column
+    double skip_table[SKIP_TABLE + 1];
+    build_skip_table(percent_nonzero, skip_table);
+    long capacity = (long) rows * cols / 100 * percent_nonzero + 16; // Expected non-zeros, grown if needed
 
-    *I = malloc(local_nz * sizeof(int));
-    *J = malloc(local_nz * sizeof(int));
-    *vals = malloc(local_nz * sizeof(double));
+    *I = (int *) malloc(capacity * sizeof(int));
+    *J = (int *) malloc(capacity * sizeof(int));
+    *vals = (double *) malloc(capacity * sizeof(double));
     if (!*I || !*J || !*vals) {
         fprintf(stderr, "COO allocation failed\n");
         return false;
     }
 
     /* Generate COO representation */
-    int index = 0;
-    for (int i = 0; i < rows; ++i) {
-        for (int j = 0; j < cols; ++j) {
-            int k = i * cols + j;
-            if (mask[k]) {
-                // Decide the value sign randomly
-                double sign = ((rand() & 1) ? -1.0 : 1.0);
-                (*I)[index] = i;
-                (*J)[index] = j;
-                // Obtain values between -10.0 and 10.0
-                (*vals)[index] = sign * ((rand() % 1000) / 100.0);
-                index++;
+    long index = 0;
+    for (int i = 0; i < rows && percent_nonzero > 0; ++i) {
+        long j = -1;
+        while (true) {
+            double u = ((double) rand() + 1.0) / ((double) RAND_MAX + 1.0); // Uniform in (0, 1]
+            j += 1 + geometric_skip(skip_table, u);
+            if (j >= cols) {
+                break;
             }
+
+            if (index == NZ_MAX) {
+                fprintf(stderr, "More than %ld non-zeros, the code must be compiled with -DLONG_NZ\n", (long) NZ_MAX);
+                fflush(stderr);
+                return false;
+            }
+            if (index == capacity) {
+                capacity *= 2;
+                if (!grow_arrays(capacity, I, J, vals)) {
+                    return false;
+                }
+            }
+            // Decide the value sign randomly
+            double sign = ((rand() & 1) ? -1.0 : 1.0);
+            (*I)[index] = i;
+            (*J)[index] = (int) j;
+            // Obtain values between -10.0 and 10.0
+            (*vals)[index] = sign * ((rand() % 1000) / 100.0);
+            index++;
         }
     }
 
+    *nz = (nz_t) index;
     return true;
 }
 
 
-bool coo_to_csr(int nz, int start_row, int M, int *I, int *J, double *vals, int **row_ptr) {
+bool coo_to_csr(nz_t nz, int start_row, int M, int *I, int *J, double *vals, nz_t **row_ptr) {
     // Sort by row indices
     bubbleSort(I, J, vals, nz);
     
     // Conversion from COO to CSR
-    int index = 0;
-    *row_ptr = (int *) malloc((M+1) * sizeof(int));
+    nz_t index = 0;
+    *row_ptr = (nz_t *) malloc((M+1) * sizeof(nz_t));
     if (!(*row_ptr)) {
         fprintf(stderr, "Allocation failed. Needed ~%zu MB for COO format alone.\n",
-                ((M+1 * sizeof(int))) / (1024 * 1024));
+                ((M+1 * sizeof(nz_t))) / (1024 * 1024));
         fflush(stderr);
         return false;
     }
@@ -83,3 +177,66 @@ bool coo_to_csr(int nz, int start_row, int M, int *I, int *J, double *vals, int
 
     return true;
 }
+
+
+bool generate_rows(uint64_t seed, int start_row, int end_row, int start_col, int end_col, int percent_nonzero, nz_t **row_ptr, int **col_idx, double **vals, nz_t *nz) {
+    // Same distribution as generate_matrix, but row i only depends on the seed and i: its n-th
+    // random draw is the Philox output for counter (n, i), so the matrix is identical for any number
+    // of processes. Only rows [start_row, end_row) are generated, directly in CSR, keeping the
+    // columns in [start_col, end_col) as local columns. Time and memory are O(nz) of the rows.
+    int local_M = end_row - start_row;
+    double skip_table[SKIP_TABLE + 1];
+    build_skip_table(percent_nonzero, skip_table);
+    long capacity = (long) local_M * (end_col - start_col) / 100 * percent_nonzero + 16; // Expected non-zeros, grown if needed
+
+    *row_ptr = (nz_t *) malloc((local_M + 1) * sizeof(nz_t));
+    *col_idx = (int *) malloc(capacity * sizeof(int));
+    *vals = (double *) malloc(capacity * sizeof(double));
+    if (!*row_ptr || !*col_idx || !*vals) {
+        fprintf(stderr, "CSR allocation failed\n");
+        fflush(stderr);
+        return false;
+    }
+
+    long index = 0;
+    (*row_ptr)[0] = 0;
+    for (int i = 0; i < local_M; i++) {
+        long j = -1;
+        // One Philox call per non-zero: 53 bits for the skip, then sign and value
+        for (uint32_t n = 0; percent_nonzero > 0; n++) {
+            uint32_t counter[4] = {n, (uint32_t) (start_row + i), 0, 0};
+            uint32_t random[4];
+            philox4x32(counter, seed, random);
+            uint64_t bits = ((uint64_t) random[0] << 21) ^ (random[1] >> 11);
+            double u = ((double) (bits & ((1ull << 53) - 1)) + 1.0) / 9007199254740992.0; // Uniform in (0, 1]
+            j += 1 + geometric_skip(skip_table, u);
+            if (j >= end_col) {
+                break;
+            }
+            if (j < start_col) {
+                continue;
+            }
+
+            if (index == NZ_MAX) {
+                fprintf(stderr, "More than %ld non-zeros, the code must be compiled with -DLONG_NZ\n", (long) NZ_MAX);
+                fflush(stderr);
+                return false;
+            }
+            if (index == capacity) {
+                capacity *= 2;
+                if (!grow_arrays(capacity, NULL, col_idx, vals)) {
+                    return false;
+                }
+            }
+            // Decide the value sign randomly, values between -10.0 and 10.0
+            double sign = (random[2] & 1) ? -1.0 : 1.0;
+            (*col_idx)[index] = (int) (j - start_col);
+            (*vals)[index] = sign * ((random[3] % 1000) / 100.0);
+            index++;
+        }
+        (*row_ptr)[i+1] = (nz_t) index;
+    }
+
+    *nz = (nz_t) index;
+    return true;
+}
@@ -0,0 +1,361 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "matrix_families.h"
+#include "generator.h"
+
+/*
+ * Structured synthetic matrices, to benchmark on something closer to real inputs than uniform
+ * random positions. Like generate_rows, every family builds only the rows [start_row, end_row)
+ * directly in CSR, keeping the columns in [start_col, end_col) as local columns, and row i only
+ * depends on the seed and i, so the matrix is identical for any number of processes.
+ * The random draws use the Philox generator with counter (n, i, stream, attempt), the streams
+ * are disjoint from the one of generate_rows (stream 0):
+ *   1: values, 2: choice of the dense rows, 3: rounding of the R-MAT degrees, 8+: R-MAT column bits
+ */
+
+#define STREAM_VALUES 1
+#define STREAM_DENSE_ROWS 2
+#define STREAM_RMAT_DEGREE 3
+#define STREAM_RMAT_BITS 8
+
+#define RMAT_A 0.57 // Quadrant probabilities of the Graph500 R-MAT generator
+#define RMAT_B 0.19
+#define RMAT_C 0.19
+#define RMAT_D 0.05
+#define RMAT_MAX_ATTEMPTS 64 // Draws of a column outside the matrix before the entry is dropped
+
+#define DENSE_ROW_EVERY 1000 // Average distance between the dense rows of FAMILY_DENSE_ROWS
+
+static const char *family_names[MATRIX_FAMILIES] = {"uniform", "rmat", "laplace2d", "laplace3d", "blockdiag", "denserows"};
+
+bool parse_matrix_family(char *name, int *family) {
+    for (int f = 0; f < MATRIX_FAMILIES; f++) {
+        if (strcmp(name, family_names[f]) == 0) {
+            *family = f;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *matrix_family_name(int family) {
+    return (family >= 0 && family < MATRIX_FAMILIES) ? family_names[family] : "unknown";
+}
+
+static double random_value(uint64_t seed, int row, int col) {
+    // Value of entry (row, col), between -10.0 and 10.0 as in the uniform generators
+    uint32_t counter[4] = {(uint32_t) col, (uint32_t) row, STREAM_VALUES, 0};
+    uint32_t random[4];
+    philox4x32(counter, seed, random);
+    double sign = (random[0] & 1) ? -1.0 : 1.0;
+    return sign * ((random[1] % 1000) / 100.0);
+}
+
+static bool append_entry(long *index, long *capacity, int **col_idx, double **vals, int col, double val) {
+    if (*index == NZ_MAX) {
+        fprintf(stderr, "More than %ld non-zeros, the code must be compiled with -DLONG_NZ\n", (long) NZ_MAX);
+        fflush(stderr);
+        return false;
+    }
+    if (*index == *capacity) {
+        *capacity *= 2;
+        int *new_col_idx = (int *) realloc(*col_idx, *capacity * sizeof(int));
+        if (new_col_idx) {
+            *col_idx = new_col_idx;
+        }
+        double *new_vals = (double *) realloc(*vals, *capacity * sizeof(double));
+        if (new_vals) {
+            *vals = new_vals;
+        }
+        if (!new_col_idx || !new_vals) {
+            fprintf(stderr, "Allocation failed while growing the matrix\n");
+            fflush(stderr);
+            return false;
+        }
+    }
+    (*col_idx)[*index] = col;
+    (*vals)[*index] = val;
+    (*index)++;
+    return true;
+}
+
+static int compare_int(const void *a, const void *b) {
+    int x = *(const int *) a, y = *(const int *) b;
+    return (x > y) - (x < y);
+}
+
+
+/* R-MAT: each entry descends the quadrants of the matrix, one level per bit of the indices */
+
+static int rmat_column(uint64_t seed, int row, long draw, int levels, uint32_t top, uint32_t bottom) {
+    // Given the row, the column bit of each level is 0 with probability A/(A+B) under a row bit 0
+    // and C/(C+D) under a row bit 1: the column of an R-MAT entry conditioned on its row.
+    // Each Philox call gives 8 levels of 16 bits.
+    int col = 0;
+    uint32_t random[4];
+    for (int k = levels - 1, used = 8; k >= 0; k--, used++) {
+        if (used == 8) {
+            uint32_t counter[4] = {(uint32_t) draw, (uint32_t) row, STREAM_RMAT_BITS + (levels - 1 - k) / 8, (uint32_t) (draw >> 32)};
+            philox4x32(counter, seed, random);
+            used = 0;
+        }
+        uint32_t bits = (random[used / 2] >> (16 * (used % 2))) & 0xFFFF;
+        uint32_t threshold = ((row >> k) & 1) ? bottom : top;
+        col = (col << 1) | (bits >= threshold);
+    }
+    return col;
+}
+
+static bool rmat_rows(uint64_t seed, int M, int N, int start_row, int end_row, int start_col, int end_col, int percent_nonzero,
+                      nz_t *row_ptr, int **col_idx, double **vals, long *index, long *capacity) {
+    int levels = 0; // Levels of the 2^levels x 2^levels matrix the rows and columns belong to
+    while ((1L << levels) < M || (1L << levels) < N) {
+        levels++;
+    }
+    // Probability that an entry falls in the rows up to M - 1, the others are cut out
+    double mass = 0.0, prefix = 1.0;
+    for (int k = levels - 1; k >= 0; k--) {
+        if (((M - 1) >> k) & 1) {
+            mass += prefix * (RMAT_A + RMAT_B);
+            prefix *= RMAT_C + RMAT_D;
+        } else {
+            prefix *= RMAT_A + RMAT_B;
+        }
+    }
+    mass += prefix; // Row M - 1 itself
+    double total = (double) M * N / 100.0 * percent_nonzero; // Entries drawn, before removing the duplicates
+    uint32_t top = (uint32_t) (RMAT_A / (RMAT_A + RMAT_B) * 65536.0);
+    uint32_t bottom = (uint32_t) (RMAT_C / (RMAT_C + RMAT_D) * 65536.0);
+
+    long buffer_size = 1024;
+    int *buffer = (int *) malloc(buffer_size * sizeof(int)); // Columns drawn for the current row
+    if (!buffer) {
+        fprintf(stderr, "Allocation failed for the R-MAT row buffer\n");
+        fflush(stderr);
+        return false;
+    }
+
+    for (int i = start_row; i < end_row; i++) {
+        // Expected entries of the row, rounded up with the probability of its fractional part
+        double p_row = 1.0;
+        for (int k = 0; k < levels; k++) {
+            p_row *= ((i >> k) & 1) ? RMAT_C + RMAT_D : RMAT_A + RMAT_B;
+        }
+        double expected = total * p_row / mass;
+        long draws = (long) expected;
+        uint32_t counter[4] = {0, (uint32_t) i, STREAM_RMAT_DEGREE, 0};
+        uint32_t random[4];
+        philox4x32(counter, seed, random);
+        if (random[0] / 4294967296.0 < expected - draws) {
+            draws++;
+        }
+
+        long kept = 0;
+        for (long d = 0; d < draws; d++) {
+            int col = N;
+            for (int attempt = 0; attempt < RMAT_MAX_ATTEMPTS && col >= N; attempt++) {
+                col = rmat_column(seed, i, d * RMAT_MAX_ATTEMPTS + attempt, levels, top, bottom);
+            }
+            if (col < start_col || col >= end_col) {
+                continue;
+            }
+            if (kept == buffer_size) {
+                buffer_size *= 2;
+                int *new_buffer = (int *) realloc(buffer, buffer_size * sizeof(int));
+                if (!new_buffer) {
+                    fprintf(stderr, "Allocation failed for the R-MAT row buffer\n");
+                    fflush(stderr);
+                    free(buffer);
+                    return false;
+                }
+                buffer = new_buffer;
+            }
+            buffer[kept++] = col;
+        }
+
+        // Sorted columns, an entry drawn more than once is kept once
+        qsort(buffer, kept, sizeof(int), compare_int);
+        for (long k = 0; k < kept; k++) {
+            if (k > 0 && buffer[k] == buffer[k-1]) {
+                continue;
+            }
+            if (!append_entry(index, capacity, col_idx, vals, buffer[k] - start_col, random_value(seed, i, buffer[k]))) {
+                free(buffer);
+                return false;
+            }
+        }
+        row_ptr[i - start_row + 1] = (nz_t) *index;
+    }
+
+    free(buffer);
+    return true;
+}
+
+
+/* Stencils and blocks, one row at a time */
+
+static int grid_side(int family, int M) {
+    // Largest side of a square (cubic) grid fitting in M rows, the last grid layer
+    // is incomplete when M is not a square (a cube)
+    int side = 1;
+    int dimensions = (family == FAMILY_LAPLACE_2D) ? 2 : 3;
+    while (((dimensions == 2) ? (long) (side + 1) * (side + 1) : (long) (side + 1) * (side + 1) * (side + 1)) <= M) {
+        side++;
+    }
+    return side;
+}
+
+static int stencil_row(int family, int side, int i, int *cols, double *diagonal) {
+    // Columns of row i in increasing order, some may fall outside the matrix
+    int count = 0;
+    if (family == FAMILY_LAPLACE_2D) {
+        int x = i % side;
+        cols[count++] = i - side;
+        if (x > 0) cols[count++] = i - 1;
+        cols[count++] = i;
+        if (x < side - 1) cols[count++] = i + 1;
+        cols[count++] = i + side;
+        *diagonal = 4.0;
+    } else {
+        int plane = side * side;
+        int x = i % side, y = (i / side) % side;
+        cols[count++] = i - plane;
+        if (y > 0) cols[count++] = i - side;
+        if (x > 0) cols[count++] = i - 1;
+        cols[count++] = i;
+        if (x < side - 1) cols[count++] = i + 1;
+        if (y < side - 1) cols[count++] = i + side;
+        cols[count++] = i + plane;
+        *diagonal = 6.0;
+    }
+    return count;
+}
+
+static bool structured_rows(int family, uint64_t seed, int M, int N, int start_row, int end_row, int start_col, int end_col, int percent_nonzero,
+                            nz_t *row_ptr, int **col_idx, double **vals, long *index, long *capacity) {
+    long block = (long) N * percent_nonzero / 100; // Side of the diagonal blocks
+    if (block < 1) {
+        block = 1;
+    }
+    int side = (family == FAMILY_BLOCK_DIAGONAL) ? 0 : grid_side(family, M);
+    for (int i = start_row; i < end_row; i++) {
+        if (family == FAMILY_BLOCK_DIAGONAL) {
+            long first = (long) i / block * block;
+            for (long j = (first > start_col) ? first : start_col; j < first + block && j < end_col; j++) {
+                if (!append_entry(index, capacity, col_idx, vals, (int) (j - start_col), random_value(seed, i, (int) j))) {
+                    return false;
+                }
+            }
+        } else {
+            int cols[7];
+            double diagonal;
+            int count = stencil_row(family, side, i, cols, &diagonal);
+            for (int k = 0; k < count; k++) {
+                if (cols[k] < 0 || cols[k] >= M || cols[k] < start_col || cols[k] >= end_col) {
+                    continue;
+                }
+                if (!append_entry(index, capacity, col_idx, vals, cols[k] - start_col, (cols[k] == i) ? diagonal : -1.0)) {
+                    return false;
+                }
+            }
+        }
+        row_ptr[i - start_row + 1] = (nz_t) *index;
+    }
+    return true;
+}
+
+
+/* Uniform rows with some dense ones: the uniform matrix, with the dense rows replaced */
+
+static bool dense_rows(uint64_t seed, int start_row, int end_row, int start_col, int end_col, int percent_nonzero,
+                       nz_t *row_ptr, int **col_idx, double **vals, long *index, long *capacity) {
+    nz_t *uniform_row_ptr = NULL, uniform_nz;
+    int *uniform_col_idx = NULL;
+    double *uniform_vals = NULL;
+    if (!generate_rows(seed, start_row, end_row, start_col, end_col, percent_nonzero, &uniform_row_ptr, &uniform_col_idx, &uniform_vals, &uniform_nz)) {
+        free(uniform_row_ptr);
+        free(uniform_col_idx);
+        free(uniform_vals);
+        return false;
+    }
+
+    bool ok = true;
+    for (int i = start_row; i < end_row && ok; i++) {
+        uint32_t counter[4] = {0, (uint32_t) i, STREAM_DENSE_ROWS, 0};
+        uint32_t random[4];
+        philox4x32(counter, seed, random);
+        if (random[0] < 4294967295u / DENSE_ROW_EVERY) {
+            for (int j = start_col; j < end_col && ok; j++) {
+                ok = append_entry(index, capacity, col_idx, vals, j - start_col, random_value(seed, i, j));
+            }
+        } else {
+            int local = i - start_row;
+            for (nz_t k = uniform_row_ptr[local]; k < uniform_row_ptr[local+1] && ok; k++) {
+                ok = append_entry(index, capacity, col_idx, vals, uniform_col_idx[k], uniform_vals[k]);
+            }
+        }
+        row_ptr[i - start_row + 1] = (nz_t) *index;
+    }
+
+    free(uniform_row_ptr);
+    free(uniform_col_idx);
+    free(uniform_vals);
+    return ok;
+}
+
+
+bool generate_family_rows(int family, uint64_t seed, int M, int N, int start_row, int end_row, int start_col, int end_col, int percent_nonzero, nz_t **row_ptr, int **col_idx, double **vals, nz_t *nz) {
+    if (family == FAMILY_UNIFORM) {
+        return generate_rows(seed, start_row, end_row, start_col, end_col, percent_nonzero, row_ptr, col_idx, vals, nz);
+    }
+
+    int local_M = end_row - start_row;
+    long index = 0, capacity = (long) local_M * 8 + 16; // Grown by doubling if needed
+    *row_ptr = (nz_t *) malloc((local_M + 1) * sizeof(nz_t));
+    *col_idx = (int *) malloc(capacity * sizeof(int));
+    *vals = (double *) malloc(capacity * sizeof(double));
+    if (!*row_ptr || !*col_idx || !*vals) {
+        fprintf(stderr, "CSR allocation failed\n");
+        fflush(stderr);
+        return false;
+    }
+    (*row_ptr)[0] = 0;
+
+    bool ok;
+    if (family == FAMILY_RMAT) {
+        ok = rmat_rows(seed, M, N, start_row, end_row, start_col, end_col, percent_nonzero, *row_ptr, col_idx, vals, &index, &capacity);
+    } else if (family == FAMILY_DENSE_ROWS) {
+        ok = dense_rows(seed, start_row, end_row, start_col, end_col, percent_nonzero, *row_ptr, col_idx, vals, &index, &capacity);
+    } else {
+        ok = structured_rows(family, seed, M, N, start_row, end_row, start_col, end_col, percent_nonzero, *row_ptr, col_idx, vals, &index, &capacity);
+    }
+
+    *nz = (nz_t) index;
+    return ok;
+}
+
+bool generate_family_matrix(int family, uint64_t seed, int M, int N, int percent_nonzero, int **I, int **J, double **vals, nz_t *nz) {
+    // The whole matrix in COO format, sorted by row and column
+    nz_t *row_ptr = NULL;
+    if (!generate_family_rows(family, seed, M, N, 0, M, 0, N, percent_nonzero, &row_ptr, J, vals, nz)) {
+        free(row_ptr);
+        return false;
+    }
+    *I = (int *) malloc((*nz + 1) * sizeof(int));
+    if (!*I) {
+        fprintf(stderr, "COO allocation failed\n");
+        fflush(stderr);
+        free(row_ptr);
+        return false;
+    }
+    for (int i = 0; i < M; i++) {
+        for (nz_t k = row_ptr[i]; k < row_ptr[i+1]; k++) {
+            (*I)[k] = i;
+        }
+    }
+    free(row_ptr);
+    return true;
+}
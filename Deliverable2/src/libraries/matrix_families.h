@@ -0,0 +1,21 @@
+#ifndef MATRIX_FAMILIES_H
+#define MATRIX_FAMILIES_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "index_types.h"
+
+#define FAMILY_UNIFORM 0 // Uniform random positions, the density in every row (generate_rows)
+#define FAMILY_RMAT 1 // R-MAT / Kronecker power-law graph, the density over the whole matrix
+#define FAMILY_LAPLACE_2D 2 // 5-point stencil on a square grid, the density is ignored
+#define FAMILY_LAPLACE_3D 3 // 7-point stencil on a cubic grid, the density is ignored
+#define FAMILY_BLOCK_DIAGONAL 4 // Dense diagonal blocks of density * columns
+#define FAMILY_DENSE_ROWS 5 // Uniform random with about one completely dense row every 1000
+#define MATRIX_FAMILIES 6
+
+bool parse_matrix_family(char *name, int *family);
+const char *matrix_family_name(int family);
+bool generate_family_rows(int family, uint64_t seed, int M, int N, int start_row, int end_row, int start_col, int end_col, int percent_nonzero, nz_t **row_ptr, int **col_idx, double **vals, nz_t *nz);
+bool generate_family_matrix(int family, uint64_t seed, int M, int N, int percent_nonzero, int **I, int **J, double **vals, nz_t *nz);
+
+#endif
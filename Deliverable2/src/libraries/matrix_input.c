@@ -0,0 +1,176 @@
+#define _GNU_SOURCE // fopencookie
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <zlib.h>
+#include "matrix_input.h"
+
+/*
+ * Matrix Market input from plain, gzip compressed and tar archived files, read as a stream.
+ * The decompressed text reaches the usual readers (mmio for the banner, fgets with parse_int
+ * and parse_double for the entries) through a FILE built with fopencookie, so nothing is
+ * unpacked on disk and the readers are unchanged:
+ *   name.mtx                       plain text, fopen
+ *   name.mtx.gz                    gzip stream, decompressed by zlib in chunks of GZ_BUFFER
+ *   name.tar, .tar.gz, .tgz        the member name/name.mtx (SuiteSparse layout), otherwise the first .mtx member
+ * Seeking back (the two passes of read_matrix_to_csr_partial) restarts the decompression.
+ */
+
+#define GZ_BUFFER (256 * 1024) // zlib buffer, larger than the 8 KB default for long sequential reads
+#define TAR_BLOCK 512
+
+typedef struct {
+    gzFile gz;
+    z_off_t start; // Offset of the data in the uncompressed stream (start of the tar member)
+    long long size; // Bytes of the tar member, -1 for a whole gzip file
+    long long pos; // Position from start
+} gz_stream;
+
+static ssize_t gz_stream_read(void *cookie, char *buf, size_t size) {
+    gz_stream *s = (gz_stream *) cookie;
+    if (s->size >= 0 && (long long) size > s->size - s->pos) {
+        size = (size_t) (s->size - s->pos); // Stop at the end of the tar member
+    }
+    if (size > INT_MAX) {
+        size = INT_MAX;
+    }
+    if (size == 0) {
+        return 0;
+    }
+    int n = gzread(s->gz, buf, (unsigned) size);
+    if (n < 0) {
+        return -1;
+    }
+    s->pos += n;
+    return n;
+}
+
+static int gz_stream_seek(void *cookie, off64_t *offset, int whence) {
+    gz_stream *s = (gz_stream *) cookie;
+    long long target;
+    if (whence == SEEK_SET) {
+        target = *offset;
+    } else if (whence == SEEK_CUR) {
+        target = s->pos + *offset;
+    } else {
+        return -1; // The uncompressed size is not known before reading everything
+    }
+    if (target < 0 || (s->size >= 0 && target > s->size)) {
+        return -1;
+    }
+    if (target != s->pos && gzseek(s->gz, s->start + (z_off_t) target, SEEK_SET) < 0) {
+        return -1;
+    }
+    s->pos = target;
+    *offset = target;
+    return 0;
+}
+
+static int gz_stream_close(void *cookie) {
+    gz_stream *s = (gz_stream *) cookie;
+    int ret = gzclose(s->gz);
+    free(s);
+    return (ret == Z_OK) ? 0 : EOF;
+}
+
+static bool has_suffix(const char *name, const char *suffix) {
+    size_t name_len = strlen(name), suffix_len = strlen(suffix);
+    return name_len >= suffix_len && strcmp(name + name_len - suffix_len, suffix) == 0;
+}
+
+static long long tar_number(const unsigned char *field, int len) {
+    // Octal, or base-256 (first bit set) for members of 8 GB and more
+    long long value = 0;
+    if (field[0] & 0x80) {
+        value = field[0] & 0x7f;
+        for (int i = 1; i < len; i++) {
+            value = (value << 8) | field[i];
+        }
+        return value;
+    }
+    for (int i = 0; i < len && field[i]; i++) {
+        if (field[i] >= '0' && field[i] <= '7') {
+            value = value * 8 + (field[i] - '0');
+        }
+    }
+    return value;
+}
+
+static bool find_tar_member(gzFile gz, const char *wanted, z_off_t *start, long long *size) {
+    // Walks the headers up to the first regular .mtx member, or the one ending with "wanted" if given
+    unsigned char header[TAR_BLOCK];
+    char name[257]; // prefix, slash and name
+    while (gzread(gz, header, TAR_BLOCK) == TAR_BLOCK && header[0] != '\0') {
+        // ustar splits long paths in a prefix (345-499) and a name (0-99)
+        if (memcmp(header + 257, "ustar", 5) == 0 && header[345] != '\0') {
+            snprintf(name, sizeof(name), "%.155s/%.100s", (char *) header + 345, (char *) header);
+        } else {
+            snprintf(name, sizeof(name), "%.100s", (char *) header);
+        }
+        long long member_size = tar_number(header + 124, 12);
+        bool regular = header[156] == '0' || header[156] == '\0';
+
+        if (regular && has_suffix(name, ".mtx") && (!wanted || has_suffix(name, wanted))) {
+            *start = gztell(gz);
+            *size = member_size;
+            return true;
+        }
+        long long skip = (member_size + TAR_BLOCK - 1) / TAR_BLOCK * TAR_BLOCK;
+        if (skip > 0 && gzseek(gz, (z_off_t) skip, SEEK_CUR) < 0) {
+            return false;
+        }
+    }
+    return false;
+}
+
+FILE *open_matrix_input(char *filename) {
+    bool tar = has_suffix(filename, ".tar") || has_suffix(filename, ".tar.gz") || has_suffix(filename, ".tgz");
+    if (!tar && !has_suffix(filename, ".gz")) {
+        return fopen(filename, "r");
+    }
+
+    // gzopen also reads uncompressed files, so a plain .tar goes through the same path
+    gz_stream *s = (gz_stream *) malloc(sizeof(gz_stream));
+    if (!s) {
+        return NULL;
+    }
+    s->gz = gzopen(filename, "rb");
+    s->start = 0;
+    s->size = -1;
+    s->pos = 0;
+    if (!s->gz) {
+        free(s);
+        return NULL;
+    }
+    gzbuffer(s->gz, GZ_BUFFER);
+
+    if (tar) {
+        // Prefer <archive name>/<archive name>.mtx, the other members are right-hand sides and extras
+        char wanted[300];
+        const char *base = strrchr(filename, '/');
+        base = base ? base + 1 : filename;
+        size_t base_len = strcspn(base, ".");
+        snprintf(wanted, sizeof(wanted), "/%.*s.mtx", (int) base_len, base);
+        bool found = find_tar_member(s->gz, wanted, &s->start, &s->size);
+        if (!found && gzrewind(s->gz) == 0) {
+            found = find_tar_member(s->gz, NULL, &s->start, &s->size);
+        }
+        if (!found) {
+            fprintf(stderr, "No .mtx file in the archive: %s\n", filename);
+            fflush(stderr);
+            gzclose(s->gz);
+            free(s);
+            return NULL;
+        }
+    }
+
+    cookie_io_functions_t functions = {gz_stream_read, NULL, gz_stream_seek, gz_stream_close};
+    FILE *f = fopencookie(s, "r", functions);
+    if (!f) {
+        gzclose(s->gz);
+        free(s);
+    }
+    return f;
+}
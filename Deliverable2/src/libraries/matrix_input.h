@@ -0,0 +1,8 @@
+#ifndef MATRIX_INPUT_H
+#define MATRIX_INPUT_H
+
+#include <stdio.h>
+
+FILE *open_matrix_input(char *filename); // .mtx, .mtx.gz, .tar, .tar.gz or .tgz, closed with fclose
+
+#endif
@@ -1,22 +1,45 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "matrix_reading.h"
+#include "matrix_input.h"
+#include "fast_parse.h"
 #include "mmio.h"
 #include "bubblesort.h"
 
-bool check_matrix_file(char *filename, int *M, int *N, int *nz) {
+static bool read_size_line(FILE *f, int *M, int *N, nz_t *nz) {
+    // Same as mm_read_mtx_crd_size, with the number of entries read in 64 bits:
+    // a file with more entries than nz_t can index is refused instead of overflowing
+    char line[MM_MAX_LINE_LENGTH + 1];
+    long long entries;
+    do {
+        if (fgets(line, sizeof(line), f) == NULL) {
+            return false;
+        }
+    } while (line[0] == '%');
+    if (sscanf(line, "%d %d %lld", M, N, &entries) != 3) {
+        return false;
+    }
+    if (entries > (long long) NZ_MAX) {
+        fprintf(stderr, "The matrix has %lld entries, the code must be compiled with -DLONG_NZ\n", entries);
+        fflush(stderr);
+        return false;
+    }
+    *nz = (nz_t) entries;
+    return true;
+}
+
+bool check_matrix_file(char *filename, int *M, int *N, nz_t *nz, MM_typecode matcode) {
     FILE *f;
-    MM_typecode matcode;
-    int ret_code;
 
-    if ((f = fopen(filename, "r")) == NULL) {
+    if ((f = open_matrix_input(filename)) == NULL) {
         fprintf(stderr, "Could not open file: %s\n", filename);
         fflush(stderr);
         return false;
     }
 
-    if (mm_read_banner(f, &matcode) != 0) {
+    if (mm_read_banner(f, (MM_typecode *) matcode) != 0) {
         fprintf(stderr, "Could not process Matrix Market banner.\n");
         fflush(stderr);
         return false;
@@ -24,14 +47,16 @@ bool check_matrix_file(char *filename, int *M, int *N, int *nz) {
 
     /*  This is how one can screen matrix types if their application */
     /*  only supports a subset of the Matrix Market data types.      */
-    if (mm_is_complex(matcode) && mm_is_matrix(matcode) && mm_is_sparse(matcode)){
+    // General, symmetric, skew-symmetric and pattern coordinate files are read as they are,
+    // complex (and hermitian) files only by read_matrix_to_csr_complex_partial
+    if (!mm_is_sparse(matcode)) {
         fprintf(stderr, "Sorry, this application does not support ");
         fprintf(stderr, "Market Market type: [%s]\n", mm_typecode_to_str(matcode));
         fflush(stderr);
         return false;
     }
 
-    if ((ret_code = mm_read_mtx_crd_size(f, M, N, nz)) !=0) {
+    if (!read_size_line(f, M, N, nz)) {
         fprintf(stderr, "Error reading matrix size.\n");
         fflush(stderr);
         return false;
@@ -45,17 +70,16 @@ bool check_matrix_file(char *filename, int *M, int *N, int *nz) {
 }
 
 
-bool read_matrix_to_csr_total(char *filename, int **row_ptr, int **J, double **vals) {
+bool read_matrix_to_csr_total(char *filename, nz_t **row_ptr, int **J, double **vals) {
     FILE *f;
     MM_typecode matcode;
-    int ret_code;
     int M; // Number of rows
     int N; // Number of columns
-    int nz; // Total number of non-zero entries
+    nz_t nz; // Total number of non-zero entries
     int *local_I = NULL;
 
     /* Simpler checks repeat, to ensure the file is correct */
-    if ((f = fopen(filename, "r")) == NULL) {
+    if ((f = open_matrix_input(filename)) == NULL) {
         fprintf(stderr, "Could not open file: %s\n", filename);
         fflush(stderr);
         return false;
@@ -75,16 +99,27 @@ bool read_matrix_to_csr_total(char *filename, int **row_ptr, int **J, double **v
 
 
     /* find out size of sparse matrix .... */
-    if ((ret_code = mm_read_mtx_crd_size(f, &M, &N, &nz)) !=0) {
+    if (!read_size_line(f, &M, &N, &nz)) {
         fprintf(stderr, "Error reading matrix size.\n");
         fflush(stderr);
         return false;
     }
 
+    /* Symmetric and skew-symmetric files store only one triangle, the mirrored entries are added here */
+    bool skew = mm_is_skew(matcode); // Mirrored entries with the opposite sign
+    bool mirrored = mm_is_symmetric(matcode) || skew;
+    bool pattern = mm_is_pattern(matcode); // No values in the file, every entry is 1
+    if (mirrored && nz > NZ_MAX / 2) {
+        fprintf(stderr, "The mirrored matrix has too many entries, the code must be compiled with -DLONG_NZ\n");
+        fflush(stderr);
+        return false;
+    }
+    nz_t max_nz = mirrored ? 2 * nz : nz;
+
     /* reseve memory for matrices */
-    local_I = (int *) malloc(nz * sizeof(int)); // Rows pointer
-    *J = (int *) malloc(nz * sizeof(int)); // Columns pointer
-    *vals = (double *) malloc(nz * sizeof(double)); // Values pointer
+    local_I = (int *) malloc(max_nz * sizeof(int)); // Rows pointer
+    *J = (int *) malloc(max_nz * sizeof(int)); // Columns pointer
+    *vals = (double *) malloc(max_nz * sizeof(double)); // Values pointer
     if (!local_I || !(*J) || !(*vals)) {
         fprintf(stderr, "Failed to allocate memory for matrix data.\n");
         fflush(stderr);
@@ -94,30 +129,46 @@ bool read_matrix_to_csr_total(char *filename, int **row_ptr, int **J, double **v
 
     /* Reading the actual matrix data */
     char line[256]; // Buffer for one line
+    nz_t stored = 0; // Entries stored, including the mirrored ones
 
-    for (int i = 0; i < nz; i++) {
+    for (nz_t i = 0; i < nz; i++) {
         // Read one line
         if (!fgets(line, sizeof(line), f)) {
-            fprintf(stderr, "Unexpected EOF or read error at line %d\n", i+1);
+            fprintf(stderr, "Unexpected EOF or read error at line %ld\n", (long) i+1);
             break;
         }
 
         char *p = line;
 
-        int row = (int)strtol(p, &p, 10); // Parse row index
+        int row;
+        p = parse_int(p, &row); // Parse row index
         row--; // Convert to 0-based indexing
 
         
-        int col = (int)strtol(p, &p, 10); // Parse column index
+        int col;
+        p = parse_int(p, &col); // Parse column index
         col--; // Convert to 0-based indexing
 
-        double val = strtod(p, NULL); // Parse value
+        double val = 1.0;
+        if (!pattern) {
+            parse_double(p, &val); // Parse value
+        }
 
         // Store in local arrays
-        local_I[i] = row;
-        (*J)[i] = col;
-        (*vals)[i] = val;
+        local_I[stored] = row;
+        (*J)[stored] = col;
+        (*vals)[stored] = val;
+        stored++;
+
+        // Add the mirrored entry, the diagonal is stored only once
+        if (mirrored && row != col) {
+            local_I[stored] = col;
+            (*J)[stored] = row;
+            (*vals)[stored] = skew ? -val : val;
+            stored++;
+        }
     }
+    nz = stored;
 
 
     if (f != stdin) {
@@ -140,11 +191,11 @@ bool read_matrix_to_csr_total(char *filename, int **row_ptr, int **J, double **v
     bubbleSort(local_I, *J, *vals, nz);
     
     //Conversion from COO to CSR
-    int index = 0;
-    *row_ptr = (int *) malloc((M+1) * sizeof(int));
+    nz_t index = 0;
+    *row_ptr = (nz_t *) malloc((M+1) * sizeof(nz_t));
     if (!(*row_ptr)) {
         fprintf(stderr, "Allocation failed. Needed ~%zu MB for COO format alone.\n",
-                ((M+1) * sizeof(int)) / (1024 * 1024));
+                ((M+1) * sizeof(nz_t)) / (1024 * 1024));
         fflush(stderr);
         return false;
     }
@@ -172,95 +223,162 @@ bool read_matrix_to_csr_total(char *filename, int **row_ptr, int **J, double **v
 }
 
 
-bool read_matrix_to_csr_partial(char *filename, int start_row, int end_row, int *local_nz, int **row_ptr, int **J, double **vals) {
+bool read_matrix_to_csr_partial(char *filename, int start_row, int end_row, MM_typecode matcode, int *iperm, nz_t *local_nz, nz_t **row_ptr, int **J, double **vals) {
     // Similar implementation as matrix_to_csr_total but only for rows in [start_row, end_row)
+    // Symmetric matrices are kept in symmetric storage: only the upper triangle (row <= col) is stored,
+    // so each rank owns the entries whose smaller index falls in its rows (see SpMV_sym_csr)
+    // Pattern matrices have no values array at all, *vals is left NULL (see SpMV_csr_pattern)
+    // Skew-symmetric matrices are expanded to general storage: each entry also gives (col, row, -val)
+    // With iperm != NULL the rows and columns of the reordered matrix are read (iperm[old] = new)
+    bool symmetric = mm_is_symmetric(matcode);
+    bool skew = mm_is_skew(matcode);
+    bool pattern = mm_is_pattern(matcode);
 
     FILE *f;
     int M; // Number of rows
     int N; // Number of columns
-    int nz; // Total number of non-zero entries
-    int *local_I = NULL;
+    nz_t nz; // Total number of non-zero entries
     int local_M = end_row - start_row;
 
     /* Simpler checks repeat, to ensure the file is correct */
-    if ((f = fopen(filename, "r")) == NULL) {
+    if ((f = open_matrix_input(filename)) == NULL) {
         return false;
     }
 
     /* Skip the header lines */
     char line[256];
-    while (fgets(line, sizeof(line), f) != NULL) {
-        // Just skip to the end of the header
-        if (line[0] == '%') {
-            continue;
-        }
-        // Found the first data line
-        if (sscanf(line, "%d %d %d", &M, &N, &nz) == 3) {
-            break;
-        }
+    if (!read_size_line(f, &M, &N, &nz)) {
+        fclose(f);
+        return false;
     }
 
     // Save file position after header
     long data_start_pos = ftell(f);
 
-    /* Count elements in the specified row range */
-    *local_nz = 0;
+    /* Count the entries of each local row, row_ptr[i+1] for row i */
+    *row_ptr = (nz_t *) calloc(local_M + 1, sizeof(nz_t));
+    if (!(*row_ptr)) {
+        fprintf(stderr, "Failed to allocate memory for local row pointers.\n");
+        fflush(stderr);
+        fclose(f);
+        return false;
+    }
 
-    for (int i = 0; i < nz; i++) {
+    for (nz_t i = 0; i < nz; i++) {
         if (!fgets(line, sizeof(line), f)) {
-            fprintf(stderr, "Unexpected end of file at line %d\n", i+1);
+            fprintf(stderr, "Unexpected end of file at line %ld\n", (long) i+1);
             break;
         }
 
         char *p = line;
 
-        int row_tmp = (int)strtol(p, &p, 10); // Parse only row index
+        int row_tmp;
+        p = parse_int(p, &row_tmp); // Parse only row index
         row_tmp--; // Adjust from 1-based to 0-based
+        if (iperm) {
+            row_tmp = iperm[row_tmp];
+        }
+
+        if (symmetric || skew) {
+            int col_tmp;
+            p = parse_int(p, &col_tmp);
+            col_tmp--;
+            if (iperm) {
+                col_tmp = iperm[col_tmp];
+            }
+            if (skew && col_tmp != row_tmp && col_tmp >= start_row && col_tmp < end_row) {
+                (*row_ptr)[col_tmp - start_row + 1]++; // Mirrored entry in a local row
+            }
+            if (symmetric && col_tmp < row_tmp) {
+                row_tmp = col_tmp; // The owning row is the smaller of the two indices
+            }
+        }
 
         // Count only if row belongs to local range
         if (row_tmp >= start_row && row_tmp < end_row) {
-            (*local_nz)++;
+            (*row_ptr)[row_tmp - start_row + 1]++;
         }
     }
-
+    for (int i = 0; i < local_M; i++) {
+        (*row_ptr)[i+1] += (*row_ptr)[i];
+    }
+    *local_nz = (*row_ptr)[local_M];
 
 
     /* reseve memory for matrices */
-    local_I = (int *) malloc((*local_nz) * sizeof(int)); // Rows pointer
-    *J = (int *) malloc((*local_nz) * sizeof(int)); // Columns pointer
-    *vals = (double *) malloc((*local_nz) * sizeof(double)); // Values pointer
-    if (!local_I || !(*J) || !(*vals)) {
+    // Each entry is placed directly in its row, in file order: no sort, also when iperm scrambles the rows
+    nz_t *next = (nz_t *) malloc((local_M + 1) * sizeof(nz_t)); // Next free position of each row
+    *J = (int *) malloc((*local_nz + 1) * sizeof(int)); // Columns pointer
+    *vals = NULL;
+    if (!pattern) {
+        *vals = (double *) malloc((*local_nz + 1) * sizeof(double)); // Values pointer
+    }
+    if (!next || !(*J) || (!pattern && !(*vals))) {
         fprintf(stderr, "Failed to allocate memory for local matrix data.\n");
         fflush(stderr);
+        fclose(f);
+        free(next);
         return false;
     }
+    memcpy(next, *row_ptr, (local_M + 1) * sizeof(nz_t));
 
 
     /* Reading the actual matrix data */
     fseek(f, data_start_pos, SEEK_SET); // Reset file position to start reading data
-    int index = 0;
 
-    while (index < *local_nz) {
+    for (nz_t i = 0; i < nz; i++) {
         if (!fgets(line, sizeof(line), f)) { // Read one line
             break; // EOF or error
         }
 
         char *p = line;
 
-        int row_tmp = (int)strtol(p, &p, 10); // Parse row index
+        int row_tmp;
+        p = parse_int(p, &row_tmp); // Parse row index
         row_tmp--; // Convert to 0-based indexing
 
-        // Keep only entries for local rows
-        if (row_tmp >= start_row && row_tmp < end_row) {
-            int col_tmp = (int)strtol(p, &p, 10); // Parse column index
-            col_tmp--; // convert to 0-based indexing
+        int col_tmp;
+        p = parse_int(p, &col_tmp); // Parse column index
+        col_tmp--; // convert to 0-based indexing
 
-            double value = strtod(p, NULL); // Parse value
+        // Move to the reordered indices
+        if (iperm) {
+            row_tmp = iperm[row_tmp];
+            col_tmp = iperm[col_tmp];
+        }
 
-            local_I[index] = row_tmp - start_row; // Local row index
-            (*J)[index] = col_tmp;
-            (*vals)[index] = value;
-            index++;
+        // Move lower triangle entries to the upper triangle
+        if (symmetric && col_tmp < row_tmp) {
+            int tmp = row_tmp;
+            row_tmp = col_tmp;
+            col_tmp = tmp;
+        }
+
+        // Keep only entries for local rows, the value is parsed only for those
+        bool local_row = row_tmp >= start_row && row_tmp < end_row;
+        bool local_mirror = skew && col_tmp != row_tmp && col_tmp >= start_row && col_tmp < end_row;
+        if (!local_row && !local_mirror) {
+            continue;
+        }
+
+        double val = 1.0;
+        if (!pattern) {
+            parse_double(p, &val); // Parse value
+        }
+
+        if (local_row) {
+            nz_t k = next[row_tmp - start_row]++;
+            (*J)[k] = col_tmp;
+            if (!pattern) {
+                (*vals)[k] = val;
+            }
+        }
+        if (local_mirror) {
+            nz_t k = next[col_tmp - start_row]++;
+            (*J)[k] = row_tmp;
+            if (!pattern) {
+                (*vals)[k] = -val;
+            }
         }
     }
 
@@ -268,33 +386,134 @@ bool read_matrix_to_csr_partial(char *filename, int start_row, int end_row, int
     if (f != stdin) {
         fclose(f);
     }
+    free(next);
 
-    // Sort by row indices
-    bubbleSort(local_I, *J, *vals, *local_nz);
+    return true;
+}
 
 
-    //Conversion from COO to CSR
-    index = 0;
-    *row_ptr = (int *) malloc((local_M+1) * sizeof(int));
-    if (!(*row_ptr)) {
-        fprintf(stderr, "Allocation failed. Needed ~%zu MB for COO format alone.\n",
-                ((local_M+1 * sizeof(int))) / (1024 * 1024));
+bool read_matrix_to_csr_complex_partial(char *filename, int start_row, int end_row, MM_typecode matcode, nz_t *local_nz, nz_t **row_ptr, int **J, double **vals) {
+    // Complex values of the rows in [start_row, end_row), interleaved in *vals: (re, im) of entry j at [2j] and [2j+1]
+    // Real, integer and pattern files are read with imaginary part 0
+    // Symmetric, hermitian and skew-symmetric matrices are expanded to general storage: each entry (row, col, v)
+    // also gives (col, row, v), (col, row, conj(v)) or (col, row, -v), to the process owning row col
+    // The entries are counted per row in the first pass, so the second one writes them directly in their row
+    // (in file order, as the stable bubble sort would) and no sort is needed
+    bool complex_values = mm_is_complex(matcode);
+    bool pattern = mm_is_pattern(matcode);
+    bool hermitian = mm_is_hermitian(matcode);
+    bool skew = mm_is_skew(matcode);
+    bool mirrored = mm_is_symmetric(matcode) || hermitian || skew;
+
+    FILE *f;
+    int M; // Number of rows
+    int N; // Number of columns
+    nz_t nz; // Total number of non-zero entries
+    int local_M = end_row - start_row;
+
+    if ((f = open_matrix_input(filename)) == NULL) {
+        return false;
+    }
+
+    /* Skip the header lines */
+    char line[256];
+    if (!read_size_line(f, &M, &N, &nz)) {
+        fclose(f);
+        return false;
+    }
+    if (mirrored && nz > NZ_MAX / 2) {
+        fprintf(stderr, "The mirrored matrix has too many entries, the code must be compiled with -DLONG_NZ\n");
         fflush(stderr);
+        fclose(f);
         return false;
     }
-    (*row_ptr)[0] = 0; // This is enough to initialie the array;
 
+    // Save file position after header
+    long data_start_pos = ftell(f);
+
+    /* Count the entries of each local row, row_ptr[i+1] for row i */
+    *row_ptr = (nz_t *) calloc(local_M + 1, sizeof(nz_t));
+    if (!(*row_ptr)) {
+        fprintf(stderr, "Failed to allocate memory for local row pointers.\n");
+        fflush(stderr);
+        fclose(f);
+        return false;
+    }
+    for (nz_t i = 0; i < nz; i++) {
+        if (!fgets(line, sizeof(line), f)) {
+            fprintf(stderr, "Unexpected end of file at line %ld\n", (long) i+1);
+            break;
+        }
+        int row, col;
+        char *p = parse_int(line, &row);
+        parse_int(p, &col);
+        row--;
+        col--;
+        if (row >= start_row && row < end_row) {
+            (*row_ptr)[row - start_row + 1]++;
+        }
+        if (mirrored && row != col && col >= start_row && col < end_row) {
+            (*row_ptr)[col - start_row + 1]++;
+        }
+    }
     for (int i = 0; i < local_M; i++) {
-        // Each row ends where it starts, unless we find elements
-        (*row_ptr)[i+1] = (*row_ptr)[i]; 
+        (*row_ptr)[i+1] += (*row_ptr)[i];
+    }
+    *local_nz = (*row_ptr)[local_M];
 
-        while (index < *local_nz && local_I[index] == i) {
-            (*row_ptr)[i+1]++;
-            index++;
+    /* reseve memory for matrices */
+    nz_t *next = (nz_t *) malloc((local_M + 1) * sizeof(nz_t)); // Next free position of each row
+    *J = (int *) malloc((*local_nz + 1) * sizeof(int)); // Columns pointer
+    *vals = (double *) malloc(2 * ((size_t) *local_nz + 1) * sizeof(double)); // Values pointer, two per entry
+    if (!next || !(*J) || !(*vals)) {
+        fprintf(stderr, "Failed to allocate memory for local matrix data.\n");
+        fflush(stderr);
+        fclose(f);
+        free(next);
+        return false;
+    }
+    memcpy(next, *row_ptr, (local_M + 1) * sizeof(nz_t));
+
+
+    /* Reading the actual matrix data */
+    fseek(f, data_start_pos, SEEK_SET); // Reset file position to start reading data
+    for (nz_t i = 0; i < nz; i++) {
+        if (!fgets(line, sizeof(line), f)) { // Read one line
+            break; // EOF or error
+        }
+
+        int row, col;
+        char *p = parse_int(line, &row);
+        p = parse_int(p, &col);
+        row--; // Convert to 0-based indexing
+        col--;
+
+        double re = 1.0, im = 0.0;
+        if (!pattern) {
+            p = parse_double(p, &re);
+        }
+        if (complex_values) {
+            parse_double(p, &im);
+        }
+
+        if (row >= start_row && row < end_row) {
+            nz_t k = next[row - start_row]++;
+            (*J)[k] = col;
+            (*vals)[2 * (size_t) k] = re;
+            (*vals)[2 * (size_t) k + 1] = im;
+        }
+        if (mirrored && row != col && col >= start_row && col < end_row) {
+            nz_t k = next[col - start_row]++;
+            (*J)[k] = row;
+            (*vals)[2 * (size_t) k] = skew ? -re : re;
+            (*vals)[2 * (size_t) k + 1] = (skew || hermitian) ? -im : im; // Conjugate for hermitian
         }
     }
 
-    free(local_I);
+    if (f != stdin) {
+        fclose(f);
+    }
+    free(next);
 
     return true;
 }
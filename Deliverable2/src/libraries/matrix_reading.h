@@ -1,8 +1,13 @@
 #ifndef MATRIX_READING_H
 #define MATRIX_READING_H
 
-bool check_matrix_file(char *filename, int *M, int *N, int *nz);
-bool read_matrix_to_csr_total(char *filename, int **row_ptr, int **J, double **vals);
-bool read_matrix_to_csr_partial(char *filename, int start_row, int end_row, int *local_nz, int **row_ptr, int **J, double **vals);
+#include <stdbool.h>
+#include "mmio.h"
+#include "index_types.h"
+
+bool check_matrix_file(char *filename, int *M, int *N, nz_t *nz, MM_typecode matcode);
+bool read_matrix_to_csr_total(char *filename, nz_t **row_ptr, int **J, double **vals);
+bool read_matrix_to_csr_partial(char *filename, int start_row, int end_row, MM_typecode matcode, int *iperm, nz_t *local_nz, nz_t **row_ptr, int **J, double **vals);
+bool read_matrix_to_csr_complex_partial(char *filename, int start_row, int end_row, MM_typecode matcode, nz_t *local_nz, nz_t **row_ptr, int **J, double **vals);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,769 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "partitioning.h"
+
+/*
+ * Multilevel graph partitioning of the rows of a square matrix (graph of A + A^T),
+ * by recursive bisection. Each bisection:
+ *   1. coarsens the graph by heavy-edge matching until it is small,
+ *   2. bisects the coarsest graph by greedy graph growing from a few seeds,
+ *   3. projects the bisection back level by level, refining it with Fiduccia-Mattheyses.
+ * Vertex weights are the non-zeros of the rows, so the parts are balanced in nnz.
+ */
+
+#define COARSEST_SIZE 100 // Stop coarsening below this number of vertices
+#define MAX_LEVELS 64
+#define INITIAL_TRIES 4 // Seeds tried for the initial bisection
+#define FM_PASSES 4
+#define FM_MAX_BAD_MOVES 64 // Stop a pass after this many moves without improvement
+
+typedef struct {
+    int n;
+    int *xadj, *adj, *adjw; // Adjacency lists with edge weights
+    int *vwgt; // Vertex weights
+} graph_t;
+
+/* Small deterministic generator, so the partition does not depend on the rand() state */
+static unsigned int lcg_state = 12345u;
+
+static int lcg_next(int bound) {
+    lcg_state = lcg_state * 1103515245u + 12345u;
+    return (int) ((lcg_state >> 8) % (unsigned int) bound);
+}
+
+static void free_graph(graph_t *g) {
+    free(g->xadj);
+    free(g->adj);
+    free(g->adjw);
+    free(g->vwgt);
+    g->xadj = g->adj = g->adjw = g->vwgt = NULL;
+}
+
+static bool alloc_graph(graph_t *g, int n, int edges) {
+    g->n = n;
+    g->xadj = (int *) malloc((n + 1) * sizeof(int));
+    g->adj = (int *) malloc((edges > 0 ? edges : 1) * sizeof(int));
+    g->adjw = (int *) malloc((edges > 0 ? edges : 1) * sizeof(int));
+    g->vwgt = (int *) malloc((n > 0 ? n : 1) * sizeof(int));
+    if (!g->xadj || !g->adj || !g->adjw || !g->vwgt) {
+        fprintf(stderr, "Failed to allocate memory for a graph of %d vertices\n", n);
+        fflush(stderr);
+        free_graph(g);
+        return false;
+    }
+    return true;
+}
+
+// Merge the duplicated neighbours of each vertex (summing the weights), using marker[] (all -1)
+static void merge_duplicates(graph_t *g, int *marker) {
+    int out = 0;
+    int start = 0;
+    for (int v = 0; v < g->n; v++) {
+        int end = g->xadj[v+1];
+        g->xadj[v] = out;
+        for (int j = start; j < end; j++) {
+            int u = g->adj[j];
+            if (marker[u] >= g->xadj[v]) {
+                g->adjw[marker[u]] += g->adjw[j];
+            } else {
+                marker[u] = out;
+                g->adj[out] = u;
+                g->adjw[out] = g->adjw[j];
+                out++;
+            }
+        }
+        for (int j = g->xadj[v]; j < out; j++) {
+            marker[g->adj[j]] = -1;
+        }
+        start = end;
+    }
+    g->xadj[g->n] = out;
+}
+
+static bool build_graph(int M, nz_t *row_ptr, int *col_idx, graph_t *g) {
+    // The graph keeps int edge offsets: it is built and partitioned by one process,
+    // far from the sizes that need 64-bit row pointers
+    nz_t nz = row_ptr[M];
+    if (nz > INT_MAX / 2) {
+        fprintf(stderr, "Too many non-zeros for the graph partitioner: %ld\n", (long) nz);
+        fflush(stderr);
+        return false;
+    }
+    if (!alloc_graph(g, M, 2 * (int) nz)) {
+        return false;
+    }
+    int *marker = (int *) malloc((M > 0 ? M : 1) * sizeof(int));
+    int *fill = (int *) malloc((M > 0 ? M : 1) * sizeof(int));
+    if (!marker || !fill) {
+        free(marker);
+        free(fill);
+        free_graph(g);
+        return false;
+    }
+
+    /* Both directions of every off-diagonal non-zero */
+    memset(g->xadj, 0, (M + 1) * sizeof(int));
+    for (int i = 0; i < M; i++) {
+        g->vwgt[i] = row_ptr[i+1] - row_ptr[i];
+        for (nz_t j = row_ptr[i]; j < row_ptr[i+1]; j++) {
+            int col = col_idx[j];
+            if (col != i && col < M) {
+                g->xadj[i+1]++;
+                g->xadj[col+1]++;
+            }
+        }
+    }
+    for (int i = 0; i < M; i++) {
+        g->xadj[i+1] += g->xadj[i];
+        fill[i] = g->xadj[i];
+        marker[i] = -1;
+    }
+    for (int i = 0; i < M; i++) {
+        for (nz_t j = row_ptr[i]; j < row_ptr[i+1]; j++) {
+            int col = col_idx[j];
+            if (col != i && col < M) {
+                g->adj[fill[i]] = col;
+                g->adjw[fill[i]++] = 1;
+                g->adj[fill[col]] = i;
+                g->adjw[fill[col]++] = 1;
+            }
+        }
+    }
+    merge_duplicates(g, marker);
+
+    free(marker);
+    free(fill);
+    return true;
+}
+
+/* Coarsening by heavy-edge matching, cmap[v] is the coarse vertex of v */
+static bool coarsen(graph_t *g, graph_t *coarse, int *cmap) {
+    int n = g->n;
+    int *match = (int *) malloc(n * sizeof(int));
+    int *order = (int *) malloc(n * sizeof(int));
+    int *marker = (int *) malloc(n * sizeof(int));
+    if (!match || !order || !marker) {
+        free(match);
+        free(order);
+        free(marker);
+        return false;
+    }
+
+    /* Visit the vertices in random order, matching each one with its heaviest unmatched neighbour */
+    for (int v = 0; v < n; v++) {
+        match[v] = -1;
+        order[v] = v;
+        marker[v] = -1;
+    }
+    for (int v = n - 1; v > 0; v--) {
+        int r = lcg_next(v + 1);
+        int tmp = order[v];
+        order[v] = order[r];
+        order[r] = tmp;
+    }
+    int coarse_n = 0;
+    for (int k = 0; k < n; k++) {
+        int v = order[k];
+        if (match[v] != -1) {
+            continue;
+        }
+        int best = v;
+        int best_weight = -1;
+        for (int j = g->xadj[v]; j < g->xadj[v+1]; j++) {
+            int u = g->adj[j];
+            if (match[u] == -1 && u != v && g->adjw[j] > best_weight) {
+                best = u;
+                best_weight = g->adjw[j];
+            }
+        }
+        match[v] = best;
+        match[best] = v;
+        cmap[v] = coarse_n;
+        cmap[best] = coarse_n;
+        coarse_n++;
+    }
+
+    /* Coarse graph: summed vertex weights, edges of both fine vertices merged */
+    if (!alloc_graph(coarse, coarse_n, g->xadj[n])) {
+        free(match);
+        free(order);
+        free(marker);
+        return false;
+    }
+    int edges = 0;
+    int c = 0;
+    for (int k = 0; k < n; k++) {
+        int v = order[k];
+        if (cmap[v] != c) { // Each coarse vertex is created by its first fine vertex in order
+            continue;
+        }
+        coarse->xadj[c] = edges;
+        coarse->vwgt[c] = g->vwgt[v] + (match[v] != v ? g->vwgt[match[v]] : 0);
+        for (int side = 0; side < 2; side++) {
+            int w = (side == 0) ? v : match[v];
+            if (side == 1 && w == v) {
+                break;
+            }
+            for (int j = g->xadj[w]; j < g->xadj[w+1]; j++) {
+                int cu = cmap[g->adj[j]];
+                if (cu == c) {
+                    continue; // Edge collapsed inside the coarse vertex
+                }
+                if (marker[cu] >= coarse->xadj[c]) {
+                    coarse->adjw[marker[cu]] += g->adjw[j];
+                } else {
+                    marker[cu] = edges;
+                    coarse->adj[edges] = cu;
+                    coarse->adjw[edges] = g->adjw[j];
+                    edges++;
+                }
+            }
+        }
+        for (int j = coarse->xadj[c]; j < edges; j++) {
+            marker[coarse->adj[j]] = -1;
+        }
+        c++;
+    }
+    coarse->xadj[coarse_n] = edges;
+
+    free(match);
+    free(order);
+    free(marker);
+    return true;
+}
+
+/* Max-heap of vertices keyed by gain, with positions to update keys */
+typedef struct {
+    int size;
+    int *heap, *pos;
+} heap_t;
+
+static void heap_swap(heap_t *h, int a, int b) {
+    int tmp = h->heap[a];
+    h->heap[a] = h->heap[b];
+    h->heap[b] = tmp;
+    h->pos[h->heap[a]] = a;
+    h->pos[h->heap[b]] = b;
+}
+
+static void heap_up(heap_t *h, int i, int *gain) {
+    while (i > 0 && gain[h->heap[(i-1)/2]] < gain[h->heap[i]]) {
+        heap_swap(h, i, (i-1)/2);
+        i = (i-1)/2;
+    }
+}
+
+static void heap_down(heap_t *h, int i, int *gain) {
+    while (true) {
+        int largest = i;
+        int l = 2*i + 1;
+        int r = 2*i + 2;
+        if (l < h->size && gain[h->heap[l]] > gain[h->heap[largest]]) {
+            largest = l;
+        }
+        if (r < h->size && gain[h->heap[r]] > gain[h->heap[largest]]) {
+            largest = r;
+        }
+        if (largest == i) {
+            return;
+        }
+        heap_swap(h, i, largest);
+        i = largest;
+    }
+}
+
+static void heap_push(heap_t *h, int v, int *gain) {
+    h->heap[h->size] = v;
+    h->pos[v] = h->size;
+    h->size++;
+    heap_up(h, h->size - 1, gain);
+}
+
+static void heap_remove(heap_t *h, int v, int *gain) {
+    int i = h->pos[v];
+    h->size--;
+    if (i != h->size) {
+        heap_swap(h, i, h->size);
+        int moved = h->heap[i]; // Last element, now in the hole left by v
+        heap_up(h, i, gain);
+        heap_down(h, h->pos[moved], gain);
+    }
+    h->pos[v] = -1;
+}
+
+static void heap_update(heap_t *h, int v, int *gain) {
+    if (h->pos[v] >= 0) {
+        heap_up(h, h->pos[v], gain);
+        heap_down(h, h->pos[v], gain);
+    }
+}
+
+static long compute_cut(graph_t *g, int *side) {
+    long cut = 0;
+    for (int v = 0; v < g->n; v++) {
+        for (int j = g->xadj[v]; j < g->xadj[v+1]; j++) {
+            if (side[v] != side[g->adj[j]]) {
+                cut += g->adjw[j];
+            }
+        }
+    }
+    return cut / 2;
+}
+
+// Amount by which the sides exceed their maximum weight (0 when balanced)
+static long overweight(long *weight, long *max_weight) {
+    long over = 0;
+    for (int s = 0; s < 2; s++) {
+        if (weight[s] > max_weight[s]) {
+            over += weight[s] - max_weight[s];
+        }
+    }
+    return over;
+}
+
+/* Fiduccia-Mattheyses refinement of a bisection, returns the final cut */
+static long fm_refine(graph_t *g, int *side, long *max_weight) {
+    int n = g->n;
+    int *gain = (int *) malloc(n * sizeof(int));
+    int *moves = (int *) malloc(n * sizeof(int));
+    bool *locked = (bool *) malloc(n * sizeof(bool));
+    heap_t heaps[2];
+    heaps[0].heap = (int *) malloc(n * sizeof(int));
+    heaps[0].pos = (int *) malloc(n * sizeof(int));
+    heaps[1].heap = (int *) malloc(n * sizeof(int));
+    heaps[1].pos = (int *) malloc(n * sizeof(int));
+    if (!gain || !moves || !locked || !heaps[0].heap || !heaps[0].pos || !heaps[1].heap || !heaps[1].pos) {
+        free(gain);
+        free(moves);
+        free(locked);
+        free(heaps[0].heap);
+        free(heaps[0].pos);
+        free(heaps[1].heap);
+        free(heaps[1].pos);
+        return compute_cut(g, side);
+    }
+
+    long cut = compute_cut(g, side);
+    long weight[2] = {0, 0};
+    for (int v = 0; v < n; v++) {
+        weight[side[v]] += g->vwgt[v];
+    }
+
+    for (int pass = 0; pass < FM_PASSES; pass++) {
+        /* Gains: external minus internal edge weight */
+        heaps[0].size = 0;
+        heaps[1].size = 0;
+        for (int v = 0; v < n; v++) {
+            gain[v] = 0;
+            for (int j = g->xadj[v]; j < g->xadj[v+1]; j++) {
+                gain[v] += (side[g->adj[j]] != side[v]) ? g->adjw[j] : -g->adjw[j];
+            }
+            locked[v] = false;
+            heaps[0].pos[v] = -1;
+            heaps[1].pos[v] = -1;
+        }
+        for (int v = 0; v < n; v++) {
+            heap_push(&heaps[side[v]], v, gain);
+        }
+
+        long start_cut = cut;
+        long best_cut = cut;
+        long best_over = overweight(weight, max_weight);
+        int best_moves = 0;
+        int num_moves = 0;
+
+        while (num_moves - best_moves < FM_MAX_BAD_MOVES) {
+            /* Best vertex that can move without breaking the balance (or that reduces the imbalance) */
+            int from = -1;
+            for (int s = 0; s < 2; s++) {
+                if (heaps[s].size == 0) {
+                    continue;
+                }
+                int v = heaps[s].heap[0];
+                bool fits = weight[1-s] + g->vwgt[v] <= max_weight[1-s] || weight[s] > max_weight[s];
+                if (fits && (from == -1 || gain[v] > gain[heaps[from].heap[0]])) {
+                    from = s;
+                }
+            }
+            if (from == -1) {
+                break;
+            }
+
+            int v = heaps[from].heap[0];
+            heap_remove(&heaps[from], v, gain);
+            locked[v] = true;
+            cut -= gain[v];
+            weight[from] -= g->vwgt[v];
+            weight[1-from] += g->vwgt[v];
+            side[v] = 1 - from;
+            gain[v] = -gain[v];
+            moves[num_moves++] = v;
+
+            /* Update the neighbours */
+            for (int j = g->xadj[v]; j < g->xadj[v+1]; j++) {
+                int u = g->adj[j];
+                if (locked[u]) {
+                    continue;
+                }
+                gain[u] += (side[u] == side[v]) ? -2 * g->adjw[j] : 2 * g->adjw[j];
+                heap_update(&heaps[side[u]], u, gain);
+            }
+
+            long over = overweight(weight, max_weight);
+            if (over < best_over || (over == best_over && cut < best_cut)) {
+                best_over = over;
+                best_cut = cut;
+                best_moves = num_moves;
+            }
+        }
+
+        /* Undo the moves after the best state */
+        for (int k = num_moves - 1; k >= best_moves; k--) {
+            int v = moves[k];
+            weight[side[v]] -= g->vwgt[v];
+            side[v] = 1 - side[v];
+            weight[side[v]] += g->vwgt[v];
+        }
+        cut = best_cut;
+
+        if (best_cut >= start_cut) {
+            break; // No improvement in this pass
+        }
+    }
+
+    free(gain);
+    free(moves);
+    free(locked);
+    free(heaps[0].heap);
+    free(heaps[0].pos);
+    free(heaps[1].heap);
+    free(heaps[1].pos);
+    return cut;
+}
+
+/* Initial bisection of the coarsest graph: grow side 0 breadth-first from a seed up to its target weight */
+static bool initial_bisection(graph_t *g, int *side, long target0, long *max_weight) {
+    int n = g->n;
+    int *trial = (int *) malloc((n > 0 ? n : 1) * sizeof(int));
+    int *queue = (int *) malloc((n > 0 ? n : 1) * sizeof(int));
+    if (!trial || !queue) {
+        free(trial);
+        free(queue);
+        return false;
+    }
+
+    long best_cut = -1;
+    for (int attempt = 0; attempt < INITIAL_TRIES && n > 0; attempt++) {
+        for (int v = 0; v < n; v++) {
+            trial[v] = 1;
+        }
+        long weight0 = 0;
+        int head = 0;
+        int tail = 0;
+        int next_seed = lcg_next(n);
+        while (weight0 < target0) {
+            if (head == tail) { // New seed (first one, or the component is exhausted)
+                int seed = -1;
+                for (int k = 0; k < n; k++) {
+                    int v = (next_seed + k) % n;
+                    if (trial[v] == 1) {
+                        seed = v;
+                        break;
+                    }
+                }
+                if (seed < 0) {
+                    break;
+                }
+                trial[seed] = 0;
+                weight0 += g->vwgt[seed];
+                queue[tail++] = seed;
+                continue;
+            }
+            int v = queue[head++];
+            for (int j = g->xadj[v]; j < g->xadj[v+1] && weight0 < target0; j++) {
+                int u = g->adj[j];
+                if (trial[u] == 1) {
+                    trial[u] = 0;
+                    weight0 += g->vwgt[u];
+                    queue[tail++] = u;
+                }
+            }
+        }
+
+        long cut = fm_refine(g, trial, max_weight);
+        if (best_cut < 0 || cut < best_cut) {
+            best_cut = cut;
+            memcpy(side, trial, n * sizeof(int));
+        }
+    }
+
+    free(trial);
+    free(queue);
+    return true;
+}
+
+/* Multilevel bisection, side 0 gets about target0 of the total weight */
+static bool multilevel_bisection(graph_t *g, long target0, double imbalance, int *side) {
+    graph_t levels[MAX_LEVELS];
+    int *cmaps[MAX_LEVELS];
+    int num_levels = 1;
+    levels[0] = *g;
+
+    long total = 0;
+    for (int v = 0; v < g->n; v++) {
+        total += g->vwgt[v];
+    }
+    long max_weight[2];
+    max_weight[0] = (long) (target0 * (1.0 + imbalance)) + 1;
+    max_weight[1] = (long) ((total - target0) * (1.0 + imbalance)) + 1;
+
+    /* Coarsening */
+    bool ok = true;
+    while (levels[num_levels-1].n > COARSEST_SIZE && num_levels < MAX_LEVELS) {
+        graph_t *fine = &levels[num_levels-1];
+        cmaps[num_levels-1] = (int *) malloc(fine->n * sizeof(int));
+        if (!cmaps[num_levels-1] || !coarsen(fine, &levels[num_levels], cmaps[num_levels-1])) {
+            free(cmaps[num_levels-1]);
+            ok = false;
+            break;
+        }
+        num_levels++;
+        if (levels[num_levels-1].n > 0.9 * fine->n) {
+            break; // Matching is not reducing the graph anymore
+        }
+    }
+
+    /* Initial bisection on the coarsest graph, then projection and refinement */
+    int *coarse_side = (int *) malloc((levels[num_levels-1].n > 0 ? levels[num_levels-1].n : 1) * sizeof(int));
+    if (ok && coarse_side) {
+        ok = initial_bisection(&levels[num_levels-1], coarse_side, target0, max_weight);
+    }
+    for (int l = num_levels - 2; l >= 0 && ok && coarse_side; l--) {
+        int *fine_side = (int *) malloc((levels[l].n > 0 ? levels[l].n : 1) * sizeof(int));
+        if (!fine_side) {
+            ok = false;
+            break;
+        }
+        for (int v = 0; v < levels[l].n; v++) {
+            fine_side[v] = coarse_side[cmaps[l][v]];
+        }
+        free(coarse_side);
+        coarse_side = fine_side;
+        fm_refine(&levels[l], coarse_side, max_weight);
+    }
+    ok = ok && coarse_side;
+    if (ok) {
+        memcpy(side, coarse_side, g->n * sizeof(int));
+    }
+
+    free(coarse_side);
+    for (int l = 1; l < num_levels; l++) {
+        free_graph(&levels[l]);
+        free(cmaps[l-1]);
+    }
+    return ok;
+}
+
+/* Subgraph induced by the vertices on one side, vertex_ids maps its vertices to the original ones */
+static bool extract_side(graph_t *g, int *side, int s, int *vertex_ids, graph_t *sub, int *sub_ids) {
+    int *local = (int *) malloc((g->n > 0 ? g->n : 1) * sizeof(int));
+    if (!local) {
+        return false;
+    }
+    int n = 0;
+    int edges = 0;
+    for (int v = 0; v < g->n; v++) {
+        local[v] = -1;
+        if (side[v] == s) {
+            local[v] = n++;
+            edges += g->xadj[v+1] - g->xadj[v];
+        }
+    }
+    if (!alloc_graph(sub, n, edges)) {
+        free(local);
+        return false;
+    }
+
+    edges = 0;
+    for (int v = 0; v < g->n; v++) {
+        if (local[v] < 0) {
+            continue;
+        }
+        int lv = local[v];
+        sub->xadj[lv] = edges;
+        sub->vwgt[lv] = g->vwgt[v];
+        sub_ids[lv] = vertex_ids[v];
+        for (int j = g->xadj[v]; j < g->xadj[v+1]; j++) {
+            if (local[g->adj[j]] >= 0) {
+                sub->adj[edges] = local[g->adj[j]];
+                sub->adjw[edges] = g->adjw[j];
+                edges++;
+            }
+        }
+    }
+    sub->xadj[n] = edges;
+
+    free(local);
+    return true;
+}
+
+static bool recursive_bisection(graph_t *g, int *vertex_ids, int nparts, int first_part, double imbalance, int *part) {
+    if (nparts == 1 || g->n == 0) {
+        for (int v = 0; v < g->n; v++) {
+            part[vertex_ids[v]] = first_part;
+        }
+        return true;
+    }
+
+    int left_parts = nparts / 2;
+    long total = 0;
+    for (int v = 0; v < g->n; v++) {
+        total += g->vwgt[v];
+    }
+    long target0 = total * left_parts / nparts;
+
+    int *side = (int *) malloc(g->n * sizeof(int));
+    if (!side || !multilevel_bisection(g, target0, imbalance, side)) {
+        free(side);
+        return false;
+    }
+
+    bool ok = true;
+    for (int s = 0; s < 2 && ok; s++) {
+        graph_t sub;
+        int *sub_ids = (int *) malloc(g->n * sizeof(int));
+        if (!sub_ids || !extract_side(g, side, s, vertex_ids, &sub, sub_ids)) {
+            free(sub_ids);
+            ok = false;
+            break;
+        }
+        int sub_parts = (s == 0) ? left_parts : nparts - left_parts;
+        int sub_first = (s == 0) ? first_part : first_part + left_parts;
+        ok = recursive_bisection(&sub, sub_ids, sub_parts, sub_first, imbalance, part);
+        free_graph(&sub);
+        free(sub_ids);
+    }
+
+    free(side);
+    return ok;
+}
+
+static double level_imbalance(double imbalance, int nparts) {
+    // Every bisection level can add its tolerance to the part weights, so each of the ceil(log2(nparts))
+    // levels gets t with (1 + t)^levels = 1 + imbalance (found by bisection on t)
+    int levels = 0;
+    while ((1 << levels) < nparts) {
+        levels++;
+    }
+    if (levels <= 1) {
+        return imbalance;
+    }
+    double low = 0.0, high = imbalance;
+    for (int it = 0; it < 60; it++) {
+        double t = 0.5 * (low + high), power = 1.0;
+        for (int l = 0; l < levels; l++) {
+            power *= 1.0 + t;
+        }
+        if (power > 1.0 + imbalance) {
+            high = t;
+        } else {
+            low = t;
+        }
+    }
+    return low;
+}
+
+bool partition_graph(int M, nz_t *row_ptr, int *col_idx, int nparts, double imbalance, int *part) {
+    // part[i] is the part (0 ... nparts-1) of row i, imbalance is the tolerance on the nnz of each part (e.g. 0.05)
+    graph_t g;
+    if (!build_graph(M, row_ptr, col_idx, &g)) {
+        return false;
+    }
+    int *vertex_ids = (int *) malloc((M > 0 ? M : 1) * sizeof(int));
+    if (!vertex_ids) {
+        free_graph(&g);
+        return false;
+    }
+    for (int v = 0; v < M; v++) {
+        vertex_ids[v] = v;
+    }
+
+    lcg_state = 12345u; // Same partition at every call
+    bool ok = recursive_bisection(&g, vertex_ids, nparts, 0, level_imbalance(imbalance, nparts), part);
+    if (!ok) {
+        fprintf(stderr, "Graph partitioning failed\n");
+        fflush(stderr);
+    }
+
+    free(vertex_ids);
+    free_graph(&g);
+    return ok;
+}
+
+bool partition_to_permutation(int M, int *part, int nparts, int *perm, int *part_rows) {
+    // Rows grouped by part (keeping their order), so part p owns a contiguous block of part_rows[p] rows
+    int *offset = (int *) calloc(nparts + 1, sizeof(int));
+    if (!offset) {
+        return false;
+    }
+    for (int i = 0; i < M; i++) {
+        offset[part[i] + 1]++;
+    }
+    for (int p = 0; p < nparts; p++) {
+        part_rows[p] = offset[p+1];
+        offset[p+1] += offset[p];
+    }
+    for (int i = 0; i < M; i++) {
+        perm[offset[part[i]]++] = i;
+    }
+    free(offset);
+    return true;
+}
+
+long cut_nonzeros(int M, nz_t *row_ptr, int *col_idx, int *part) {
+    // Non-zeros whose column belongs to another part
+    long cut = 0;
+    for (int i = 0; i < M; i++) {
+        for (nz_t j = row_ptr[i]; j < row_ptr[i+1]; j++) {
+            if (col_idx[j] < M && part[col_idx[j]] != part[i]) {
+                cut++;
+            }
+        }
+    }
+    return cut;
+}
+
+long halo_volume(int M, nz_t *row_ptr, int *col_idx, int *part, int nparts) {
+    // Vector entries each part needs from the other parts, summed over the parts
+    int *perm = (int *) malloc((M > 0 ? M : 1) * sizeof(int));
+    int *part_rows = (int *) malloc(nparts * sizeof(int));
+    int *seen = (int *) malloc((M > 0 ? M : 1) * sizeof(int));
+    if (!perm || !part_rows || !seen || !partition_to_permutation(M, part, nparts, perm, part_rows)) {
+        free(perm);
+        free(part_rows);
+        free(seen);
+        return -1;
+    }
+    for (int i = 0; i < M; i++) {
+        seen[i] = -1;
+    }
+
+    long volume = 0;
+    for (int k = 0; k < M; k++) { // Rows grouped by part
+        int i = perm[k];
+        for (nz_t j = row_ptr[i]; j < row_ptr[i+1]; j++) {
+            int col = col_idx[j];
+            if (col < M && part[col] != part[i] && seen[col] != part[i]) {
+                seen[col] = part[i];
+                volume++;
+            }
+        }
+    }
+
+    free(perm);
+    free(part_rows);
+    free(seen);
+    return volume;
+}
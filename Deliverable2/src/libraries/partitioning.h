@@ -0,0 +1,14 @@
+#ifndef PARTITIONING_H
+#define PARTITIONING_H
+
+#include <stdbool.h>
+#include "index_types.h"
+
+#define PARTITION_IMBALANCE 0.05 // Tolerance on the nnz of each part over the average
+
+bool partition_graph(int M, nz_t *row_ptr, int *col_idx, int nparts, double imbalance, int *part);
+bool partition_to_permutation(int M, int *part, int nparts, int *perm, int *part_rows);
+long cut_nonzeros(int M, nz_t *row_ptr, int *col_idx, int *part);
+long halo_volume(int M, nz_t *row_ptr, int *col_idx, int *part, int nparts);
+
+#endif
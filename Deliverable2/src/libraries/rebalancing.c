@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <mpi.h>
+#include "rebalancing.h"
+
+/*
+ * Runtime rebalancing of contiguous row blocks from measured SpMV times.
+ * The cost model spreads the time measured by each process over its rows,
+ * proportionally to the non-zeros of each row plus a constant per row, and moves
+ * the boundaries so that each block gets the same share of the total modelled cost.
+ * Processes are indexed from 0 (distribution entry) and live on rank first_rank + index.
+ */
+
+#define ROW_COST 1 // Cost of a row, in non-zeros, besides its non-zeros
+
+double time_imbalance(int processes, double *times) {
+    // Slowest process over the average, 1.0 is perfect balance
+    double max_time = 0.0, total = 0.0;
+    for (int p = 0; p < processes; p++) {
+        total += times[p];
+        if (times[p] > max_time) {
+            max_time = times[p];
+        }
+    }
+    if (total <= 0.0) {
+        return 1.0;
+    }
+    return max_time * processes / total;
+}
+
+void rebalance_boundaries(int processes, int me, int *old_dist, double *times, nz_t *row_ptr, int *new_dist) {
+    // Fills the new boundaries that fall inside the block of "me", the others are left to -1:
+    // the complete distribution is the maximum over all the processes
+    double total = 0.0, before = 0.0; // Total time and time of the blocks before "me"
+    for (int p = 0; p < processes; p++) {
+        total += times[p];
+        if (p < me) {
+            before += times[p];
+        }
+    }
+    for (int k = 0; k <= processes; k++) {
+        new_dist[k] = -1;
+    }
+    if (total <= 0.0) { // Nothing measured, keep the current distribution
+        new_dist[me+1] = old_dist[me+1];
+        return;
+    }
+
+    int local_M = old_dist[me+1] - old_dist[me];
+    long weight = (long) row_ptr[local_M] + (long) local_M * ROW_COST;
+    double scale = (weight > 0) ? times[me] / weight : 0.0; // Time per unit of weight in this block
+
+    int row = 0;
+    double cost = before; // Modelled cost of the rows before "row"
+    for (int k = 1; k < processes; k++) {
+        double target = total * k / processes;
+        if (target < before || target >= before + times[me]) {
+            continue; // Boundary inside another block
+        }
+        // Take the next row while it brings the cost closer to the target
+        while (row < local_M) {
+            double row_cost = scale * (row_ptr[row+1] - row_ptr[row] + ROW_COST);
+            if (cost + row_cost / 2 > target) {
+                break;
+            }
+            cost += row_cost;
+            row++;
+        }
+        new_dist[k] = old_dist[me] + row;
+    }
+}
+
+long rows_moved(int processes, int *old_dist, int *new_dist) {
+    long moved = 0;
+    for (int p = 0; p < processes; p++) {
+        int start = (old_dist[p] > new_dist[p]) ? old_dist[p] : new_dist[p];
+        int end = (old_dist[p+1] < new_dist[p+1]) ? old_dist[p+1] : new_dist[p+1];
+        int kept = (end > start) ? end - start : 0;
+        moved += (old_dist[p+1] - old_dist[p]) - kept;
+    }
+    return moved;
+}
+
+bool migrate_rows(int first_rank, int processes, int me, int *old_dist, int *new_dist, bool pattern, nz_t **row_ptr, int **col_idx, double **vals) {
+    // Exchanges the CSR rows (local row_ptr starting from 0) so that "me" owns the rows of its new block.
+    // Blocks stay contiguous and ordered, so rows usually move only between neighbouring processes.
+    int old_start = old_dist[me], old_end = old_dist[me+1];
+    int new_start = new_dist[me], new_end = new_dist[me+1];
+    int new_M = new_end - new_start;
+    nz_t *rp = *row_ptr;
+
+    MPI_Request *requests = (MPI_Request *) malloc(3 * processes * sizeof(MPI_Request));
+    nz_t *new_row_ptr = (nz_t *) malloc((new_M + 1) * sizeof(nz_t));
+    nz_t *slice = (nz_t *) malloc((new_M + 1) * sizeof(nz_t)); // Row pointers received from another process
+    if (!requests || !new_row_ptr || !slice) {
+        fprintf(stderr, "Process %d failed to allocate memory to migrate rows\n", first_rank + me);
+        fflush(stderr);
+        free(requests);
+        free(new_row_ptr);
+        free(slice);
+        return false;
+    }
+
+    /* Send the rows of the old block that now belong to another process */
+    // The counts stay int: a message is a part of the block of one process
+    int n_requests = 0;
+    for (int q = 0; q < processes; q++) {
+        int a = (old_start > new_dist[q]) ? old_start : new_dist[q];
+        int b = (old_end < new_dist[q+1]) ? old_end : new_dist[q+1];
+        if (q == me || a >= b) {
+            continue;
+        }
+        int first = a - old_start, last = b - old_start;
+        MPI_Isend(&rp[first], last - first + 1, MPI_NZ, first_rank + q, 1, MPI_COMM_WORLD, &requests[n_requests++]);
+        MPI_Isend(&(*col_idx)[rp[first]], (int) (rp[last] - rp[first]), MPI_INT, first_rank + q, 2, MPI_COMM_WORLD, &requests[n_requests++]);
+        if (!pattern) {
+            MPI_Isend(&(*vals)[rp[first]], (int) (rp[last] - rp[first]), MPI_DOUBLE, first_rank + q, 3, MPI_COMM_WORLD, &requests[n_requests++]);
+        }
+    }
+
+    /* Build the new row pointer, from the kept rows and the received ones */
+    new_row_ptr[0] = 0;
+    for (int q = 0; q < processes; q++) {
+        int a = (old_dist[q] > new_start) ? old_dist[q] : new_start;
+        int b = (old_dist[q+1] < new_end) ? old_dist[q+1] : new_end;
+        if (a >= b) {
+            continue;
+        }
+        nz_t *src = slice;
+        if (q == me) {
+            src = &rp[a - old_start];
+        } else {
+            MPI_Recv(slice, b - a + 1, MPI_NZ, first_rank + q, 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        }
+        for (int r = 0; r < b - a; r++) { // Non-zeros of each row first, then the prefix sum
+            new_row_ptr[a - new_start + r + 1] = src[r+1] - src[r];
+        }
+    }
+    for (int i = 0; i < new_M; i++) {
+        new_row_ptr[i+1] += new_row_ptr[i];
+    }
+
+    /* Fill columns and values */
+    nz_t new_nz = new_row_ptr[new_M];
+    int *new_col_idx = (int *) malloc((new_nz + 1) * sizeof(int));
+    double *new_vals = pattern ? NULL : (double *) malloc((new_nz + 1) * sizeof(double));
+    if (!new_col_idx || (!pattern && !new_vals)) {
+        fprintf(stderr, "Process %d failed to allocate memory for the migrated rows\n", first_rank + me);
+        fflush(stderr);
+        free(requests);
+        free(new_row_ptr);
+        free(slice);
+        free(new_col_idx);
+        free(new_vals);
+        return false;
+    }
+    for (int q = 0; q < processes; q++) {
+        int a = (old_dist[q] > new_start) ? old_dist[q] : new_start;
+        int b = (old_dist[q+1] < new_end) ? old_dist[q+1] : new_end;
+        if (a >= b) {
+            continue;
+        }
+        nz_t offset = new_row_ptr[a - new_start];
+        int count = (int) (new_row_ptr[b - new_start] - offset);
+        if (q == me) {
+            nz_t old_offset = rp[a - old_start];
+            memcpy(&new_col_idx[offset], &(*col_idx)[old_offset], count * sizeof(int));
+            if (!pattern) {
+                memcpy(&new_vals[offset], &(*vals)[old_offset], count * sizeof(double));
+            }
+        } else {
+            MPI_Recv(&new_col_idx[offset], count, MPI_INT, first_rank + q, 2, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            if (!pattern) {
+                MPI_Recv(&new_vals[offset], count, MPI_DOUBLE, first_rank + q, 3, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            }
+        }
+    }
+
+    // The old arrays are sent from, wait before freeing them
+    MPI_Waitall(n_requests, requests, MPI_STATUSES_IGNORE);
+    free(requests);
+    free(slice);
+    free(*row_ptr);
+    free(*col_idx);
+    if (*vals) {
+        free(*vals);
+    }
+    *row_ptr = new_row_ptr;
+    *col_idx = new_col_idx;
+    *vals = new_vals;
+    return true;
+}
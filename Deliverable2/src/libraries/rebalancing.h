@@ -0,0 +1,12 @@
+#ifndef REBALANCING_H
+#define REBALANCING_H
+
+#include <stdbool.h>
+#include "index_types.h"
+
+double time_imbalance(int processes, double *times);
+void rebalance_boundaries(int processes, int me, int *old_dist, double *times, nz_t *row_ptr, int *new_dist);
+long rows_moved(int processes, int *old_dist, int *new_dist);
+bool migrate_rows(int first_rank, int processes, int me, int *old_dist, int *new_dist, bool pattern, nz_t **row_ptr, int **col_idx, double **vals);
+
+#endif
@@ -0,0 +1,264 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "reordering.h"
+
+/*
+ * Symmetric reorderings of a square matrix: row and column i of the reordered matrix
+ * are row and column perm[i] of the original one (iperm is the inverse, old -> new).
+ */
+
+// Structure of A + A^T without the diagonal, neighbours of i are adj[xadj[i]] ... adj[xadj[i+1]-1]
+static bool build_symmetric_graph(int M, nz_t *row_ptr, int *col_idx, nz_t **xadj, int **adj) {
+    nz_t nz = row_ptr[M];
+    *xadj = (nz_t *) calloc(M + 1, sizeof(nz_t));
+    *adj = (int *) malloc((2 * (size_t) nz + 1) * sizeof(int));
+    if (!(*xadj) || !(*adj)) {
+        fprintf(stderr, "Failed to allocate memory for the matrix graph\n");
+        fflush(stderr);
+        return false;
+    }
+
+    /* Count both directions of every off-diagonal entry */
+    for (int i = 0; i < M; i++) {
+        for (nz_t j = row_ptr[i]; j < row_ptr[i+1]; j++) {
+            int col = col_idx[j];
+            if (col != i && col < M) {
+                (*xadj)[i+1]++;
+                (*xadj)[col+1]++;
+            }
+        }
+    }
+    for (int i = 0; i < M; i++) {
+        (*xadj)[i+1] += (*xadj)[i];
+    }
+
+    /* Fill, duplicated edges are harmless for the breadth-first searches */
+    nz_t *fill = (nz_t *) malloc((M > 0 ? M : 1) * sizeof(nz_t));
+    if (!fill) {
+        fprintf(stderr, "Failed to allocate memory for the matrix graph\n");
+        fflush(stderr);
+        return false;
+    }
+    for (int i = 0; i < M; i++) {
+        fill[i] = (*xadj)[i];
+    }
+    for (int i = 0; i < M; i++) {
+        for (nz_t j = row_ptr[i]; j < row_ptr[i+1]; j++) {
+            int col = col_idx[j];
+            if (col != i && col < M) {
+                (*adj)[fill[i]++] = col;
+                (*adj)[fill[col]++] = i;
+            }
+        }
+    }
+
+    free(fill);
+    return true;
+}
+
+// Breadth-first search from start, writing the visit order in queue[first...], returns the
+// number of visited nodes, the number of levels and where the last level starts.
+// With sort_by_degree the children of each node are visited by increasing degree
+static int bfs(int start, nz_t *xadj, int *adj, bool *visited, int *queue, int first, bool sort_by_degree, int *levels, int *last_level) {
+    int head = first;
+    int tail = first;
+    queue[tail++] = start;
+    visited[start] = true;
+    *levels = 0;
+    *last_level = first;
+
+    while (head < tail) {
+        int level_end = tail;
+        *last_level = head; // First node of the level being expanded
+        (*levels)++;
+        while (head < level_end) {
+            int node = queue[head++];
+            int children = tail;
+            for (nz_t j = xadj[node]; j < xadj[node+1]; j++) {
+                int next = adj[j];
+                if (!visited[next]) {
+                    visited[next] = true;
+                    queue[tail++] = next;
+                }
+            }
+            if (sort_by_degree) { // Insertion sort, the children of a node are few
+                for (int a = children + 1; a < tail; a++) {
+                    int node_a = queue[a];
+                    nz_t degree_a = xadj[node_a+1] - xadj[node_a];
+                    int b = a - 1;
+                    while (b >= children && xadj[queue[b]+1] - xadj[queue[b]] > degree_a) {
+                        queue[b+1] = queue[b];
+                        b--;
+                    }
+                    queue[b+1] = node_a;
+                }
+            }
+        }
+    }
+
+    return tail - first;
+}
+
+bool rcm_ordering(int M, nz_t *row_ptr, int *col_idx, int *perm) {
+    nz_t *xadj = NULL;
+    int *adj = NULL;
+    if (!build_symmetric_graph(M, row_ptr, col_idx, &xadj, &adj)) {
+        free(xadj);
+        free(adj);
+        return false;
+    }
+
+    bool *visited = (bool *) calloc(M > 0 ? M : 1, sizeof(bool));
+    bool *probe = (bool *) calloc(M > 0 ? M : 1, sizeof(bool)); // Visited flags for the start node search
+    int *probe_queue = (int *) malloc((M > 0 ? M : 1) * sizeof(int));
+    if (!visited || !probe || !probe_queue) {
+        fprintf(stderr, "Failed to allocate memory for the RCM ordering\n");
+        fflush(stderr);
+        free(xadj);
+        free(adj);
+        free(visited);
+        free(probe);
+        free(probe_queue);
+        return false;
+    }
+
+    /* Nodes sorted by degree, to find the unvisited node of minimum degree with a cursor */
+    int *by_degree = (int *) malloc((M > 0 ? M : 1) * sizeof(int));
+    if (!by_degree || !degree_ordering(M, xadj, adj, by_degree)) {
+        free(xadj);
+        free(adj);
+        free(visited);
+        free(probe);
+        free(probe_queue);
+        free(by_degree);
+        return false;
+    }
+    int cursor = 0;
+
+    int ordered = 0;
+    while (ordered < M) {
+        /* Start from the unvisited node of minimum degree */
+        while (visited[by_degree[cursor]]) {
+            cursor++;
+        }
+        int start = by_degree[cursor];
+
+        /* Move it towards a pseudo-peripheral node (George-Liu): restart from the
+           minimum degree node of the last level while the depth keeps growing */
+        int depth = 0;
+        for (int attempt = 0; attempt < 5; attempt++) {
+            int levels, last_level;
+            int count = bfs(start, xadj, adj, probe, probe_queue, 0, false, &levels, &last_level);
+
+            int candidate = probe_queue[last_level];
+            for (int a = last_level + 1; a < count; a++) {
+                int node = probe_queue[a];
+                if (xadj[node+1] - xadj[node] < xadj[candidate+1] - xadj[candidate]) {
+                    candidate = node;
+                }
+            }
+            for (int a = 0; a < count; a++) { // Reset the probe flags of this component
+                probe[probe_queue[a]] = false;
+            }
+
+            if (levels <= depth) { // The eccentricity did not grow, keep the current start
+                break;
+            }
+            depth = levels;
+            start = candidate;
+        }
+
+        /* Cuthill-McKee order of this component */
+        int levels, last_level;
+        ordered += bfs(start, xadj, adj, visited, perm, ordered, true, &levels, &last_level);
+    }
+
+    /* Reverse it */
+    for (int i = 0; i < M / 2; i++) {
+        int tmp = perm[i];
+        perm[i] = perm[M - 1 - i];
+        perm[M - 1 - i] = tmp;
+    }
+
+    free(xadj);
+    free(adj);
+    free(visited);
+    free(probe);
+    free(probe_queue);
+    free(by_degree);
+    return true;
+}
+
+bool degree_ordering(int M, nz_t *row_ptr, int *col_idx, int *perm) {
+    // Rows sorted by increasing number of non-zeros (stable counting sort)
+    (void) col_idx;
+    int max_degree = 0;
+    for (int i = 0; i < M; i++) {
+        int degree = (int) (row_ptr[i+1] - row_ptr[i]);
+        if (degree > max_degree) {
+            max_degree = degree;
+        }
+    }
+
+    int *count = (int *) calloc(max_degree + 2, sizeof(int));
+    if (!count) {
+        fprintf(stderr, "Failed to allocate memory for the degree ordering\n");
+        fflush(stderr);
+        return false;
+    }
+    for (int i = 0; i < M; i++) {
+        count[row_ptr[i+1] - row_ptr[i] + 1]++;
+    }
+    for (int d = 0; d <= max_degree; d++) {
+        count[d+1] += count[d];
+    }
+    for (int i = 0; i < M; i++) {
+        perm[count[row_ptr[i+1] - row_ptr[i]]++] = i;
+    }
+
+    free(count);
+    return true;
+}
+
+void invert_permutation(int M, int *perm, int *iperm) {
+    for (int i = 0; i < M; i++) {
+        iperm[perm[i]] = i;
+    }
+}
+
+void bandwidth_profile(int M, nz_t *row_ptr, int *col_idx, int *iperm, long *bandwidth, long *profile) {
+    // Bandwidth: max |row - col|; profile: sum over the rows of the distance between the
+    // diagonal and the first non-zero on its left. With iperm != NULL they are computed for the reordered matrix
+    *bandwidth = 0;
+    *profile = 0;
+    int *first_col = (int *) malloc((M > 0 ? M : 1) * sizeof(int));
+    if (!first_col) {
+        return;
+    }
+    for (int i = 0; i < M; i++) {
+        first_col[i] = i;
+    }
+
+    for (int i = 0; i < M; i++) {
+        int row = iperm ? iperm[i] : i;
+        for (nz_t j = row_ptr[i]; j < row_ptr[i+1]; j++) {
+            int col = iperm ? iperm[col_idx[j]] : col_idx[j];
+            long distance = (long) row - col;
+            if (distance < 0) {
+                distance = -distance;
+            }
+            if (distance > *bandwidth) {
+                *bandwidth = distance;
+            }
+            if (col < first_col[row]) {
+                first_col[row] = col;
+            }
+        }
+    }
+    for (int i = 0; i < M; i++) {
+        *profile += i - first_col[i];
+    }
+
+    free(first_col);
+}
@@ -0,0 +1,12 @@
+#ifndef REORDERING_H
+#define REORDERING_H
+
+#include <stdbool.h>
+#include "index_types.h"
+
+bool rcm_ordering(int M, nz_t *row_ptr, int *col_idx, int *perm);
+bool degree_ordering(int M, nz_t *row_ptr, int *col_idx, int *perm);
+void invert_permutation(int M, int *perm, int *iperm);
+void bandwidth_profile(int M, nz_t *row_ptr, int *col_idx, int *iperm, long *bandwidth, long *profile);
+
+#endif
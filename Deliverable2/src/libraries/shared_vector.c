@@ -0,0 +1,44 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <mpi.h>
+#include "shared_vector.h"
+
+/*
+ * Node-aware distribution of the vector: the processes of a node share one copy of it,
+ * allocated by the node leader (lowest rank of the node) in an MPI shared memory window.
+ * Only the leaders take part in the broadcast, the other processes read the leader's copy.
+ * Rank 0 is always the leader of its node and the root of the broadcast.
+ */
+
+void node_comms_create(int rank, MPI_Comm *node_comm, MPI_Comm *leader_comm) {
+    int node_rank;
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, node_comm);
+    MPI_Comm_rank(*node_comm, &node_rank);
+    // One process per node, ordered by rank so rank 0 is rank 0 of leader_comm too
+    MPI_Comm_split(MPI_COMM_WORLD, (node_rank == 0) ? 0 : MPI_UNDEFINED, rank, leader_comm);
+}
+
+bool shared_vector_allocate(MPI_Comm node_comm, int count, MPI_Win *win, double **vector) {
+    // Collective on the node: only the leader allocates, the others get a pointer to its memory
+    int node_rank, disp_unit;
+    MPI_Aint win_size;
+    MPI_Comm_rank(node_comm, &node_rank);
+    MPI_Aint local_size = (node_rank == 0) ? (MPI_Aint) count * sizeof(double) : 0;
+    if (MPI_Win_allocate_shared(local_size, sizeof(double), MPI_INFO_NULL, node_comm, vector, win) != MPI_SUCCESS) {
+        fprintf(stderr, "Failed to allocate the shared vector window\n");
+        fflush(stderr);
+        return false;
+    }
+    MPI_Win_shared_query(*win, 0, &win_size, &disp_unit, vector);
+    return true;
+}
+
+void shared_vector_bcast(MPI_Comm leader_comm, MPI_Win win, double *vector, int count) {
+    // Collective on the node, rank 0 has already filled its copy
+    MPI_Win_fence(0, win);
+    if (leader_comm != MPI_COMM_NULL) {
+        MPI_Bcast(vector, count, MPI_DOUBLE, 0, leader_comm);
+    }
+    MPI_Win_fence(0, win); // The copy of the leader is complete and visible to the node
+}
@@ -0,0 +1,11 @@
+#ifndef SHARED_VECTOR_H
+#define SHARED_VECTOR_H
+
+#include <stdbool.h>
+#include <mpi.h>
+
+void node_comms_create(int rank, MPI_Comm *node_comm, MPI_Comm *leader_comm);
+bool shared_vector_allocate(MPI_Comm node_comm, int count, MPI_Win *win, double **vector);
+void shared_vector_bcast(MPI_Comm leader_comm, MPI_Win win, double *vector, int count);
+
+#endif
@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <mpi.h>
+#include "streaming.h"
+#include "csr_cache.h"
+
+/*
+ * Out-of-core SpMV over the binary CSR cache (csr_cache.c), for matrices larger than the memory.
+ * Only row_ptr, the vector and the result stay in memory: col_idx and vals are read in blocks
+ * of whole rows of at most chunk_bytes, into two buffers used in turn. While the product runs
+ * on the block in one buffer, the next block is read into the other one with non-blocking
+ * MPI-IO reads (MPI_File_iread_at on MPI_COMM_SELF), so reading and computing overlap and the
+ * product runs at about the disk bandwidth. A row longer than a chunk gets a block of its own.
+ */
+
+static int block_end(int M, nz_t *row_ptr, int start, nz_t capacity) {
+    // Rows [start, end) fitting in capacity non-zeros, at least one
+    int end = start + 1;
+    while (end < M && row_ptr[end+1] - row_ptr[start] <= capacity) {
+        end++;
+    }
+    return end;
+}
+
+static void read_block(MPI_File file, size_t col_idx_start, size_t vals_start, nz_t first, int count, int *col_idx, double *vals, MPI_Request *requests) {
+    MPI_File_iread_at(file, (MPI_Offset) (col_idx_start + (size_t) first * sizeof(int)), col_idx, count, MPI_INT, &requests[0]);
+    requests[1] = MPI_REQUEST_NULL;
+    if (vals) {
+        MPI_File_iread_at(file, (MPI_Offset) (vals_start + (size_t) first * sizeof(double)), vals, count, MPI_DOUBLE, &requests[1]);
+    }
+}
+
+static bool wait_block(MPI_Request *requests, int count, bool has_vals) {
+    // Both reads must be complete, a short count means a truncated cache
+    MPI_Status statuses[2];
+    int read_cols = 0, read_vals = 0;
+    if (MPI_Waitall(2, requests, statuses) != MPI_SUCCESS) {
+        return false;
+    }
+    MPI_Get_count(&statuses[0], MPI_INT, &read_cols);
+    if (has_vals) {
+        MPI_Get_count(&statuses[1], MPI_DOUBLE, &read_vals);
+    }
+    return read_cols == count && (!has_vals || read_vals == count);
+}
+
+static void block_product(int start, int end, nz_t *row_ptr, int *col_idx, double *vals, bool symmetric, double *vector, double *result) {
+    // The products of SpMV_csr, SpMV_csr_pattern and SpMV_sym_csr(_pattern) on rows [start, end),
+    // with col_idx and vals holding only the block, from its first non-zero
+    nz_t base = row_ptr[start];
+    for (int row = start; row < end; row++) {
+        nz_t first = row_ptr[row] - base, last = row_ptr[row+1] - base;
+        double sum = 0.0;
+        if (symmetric) {
+            double x_row = vector[row];
+            for (nz_t j = first; j < last; j++) {
+                int col = col_idx[j];
+                double val = vals ? vals[j] : 1.0;
+                sum += val * vector[col];
+                if (col != row) {
+                    result[col] += val * x_row; // Transposed contribution, always to a later row
+                }
+            }
+        } else if (vals) {
+            for (nz_t j = first; j < last; j++) {
+                sum += vals[j] * vector[col_idx[j]];
+            }
+        } else {
+            for (nz_t j = first; j < last; j++) {
+                sum += vector[col_idx[j]];
+            }
+        }
+        result[row] += sum;
+    }
+}
+
+bool SpMV_csr_stream(char *cache_name, int M, bool symmetric, long chunk_bytes, double *vector, double *result, double *wait_time, long *bytes_read) {
+    // wait_time is the time spent waiting for the reads, the part of the reading not hidden by the products
+    int cache_M, cache_N;
+    nz_t nz;
+    bool has_vals;
+    size_t col_idx_start, vals_start;
+    if (!read_csr_cache_layout(cache_name, &cache_M, &cache_N, &nz, &has_vals, &col_idx_start, &vals_start)) {
+        return false;
+    }
+    if (cache_M != M || M < 1) {
+        fprintf(stderr, "The CSR cache %s has %d rows instead of %d\n", cache_name, cache_M, M);
+        fflush(stderr);
+        return false;
+    }
+
+    MPI_File file;
+    if (MPI_File_open(MPI_COMM_SELF, cache_name, MPI_MODE_RDONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS) {
+        fprintf(stderr, "Failed to open the CSR cache: %s\n", cache_name);
+        fflush(stderr);
+        return false;
+    }
+
+    /* Row pointers, the only part of the matrix kept in memory */
+    nz_t *row_ptr = (nz_t *) malloc(((size_t) M + 1) * sizeof(nz_t));
+    MPI_Status status;
+    int read_rows = 0;
+    if (!row_ptr) {
+        fprintf(stderr, "Failed to allocate memory for the row pointers of the CSR cache\n");
+        fflush(stderr);
+        MPI_File_close(&file);
+        return false;
+    }
+    size_t row_ptr_start = col_idx_start - ((size_t) M + 1) * sizeof(nz_t);
+    if (MPI_File_read_at(file, (MPI_Offset) row_ptr_start, row_ptr, M + 1, MPI_NZ, &status) != MPI_SUCCESS
+        || MPI_Get_count(&status, MPI_NZ, &read_rows) != MPI_SUCCESS || read_rows != M + 1) {
+        fprintf(stderr, "Failed to read the row pointers of the CSR cache: %s\n", cache_name);
+        fflush(stderr);
+        MPI_File_close(&file);
+        free(row_ptr);
+        return false;
+    }
+
+    /* Two buffers of a chunk, or of the longest row if it is longer */
+    size_t entry_bytes = sizeof(int) + (has_vals ? sizeof(double) : 0);
+    nz_t capacity = (nz_t) (chunk_bytes / (long) entry_bytes);
+    if (capacity > INT_MAX) {
+        capacity = INT_MAX; // MPI counts are int
+    }
+    nz_t buffer_size = (capacity > 0) ? capacity : 1;
+    for (int i = 0; i < M; i++) {
+        if (row_ptr[i+1] - row_ptr[i] > buffer_size) {
+            buffer_size = row_ptr[i+1] - row_ptr[i];
+        }
+    }
+    int *col_buffer[2] = {NULL, NULL};
+    double *val_buffer[2] = {NULL, NULL};
+    bool ok = true;
+    for (int b = 0; b < 2; b++) {
+        col_buffer[b] = (int *) malloc((size_t) buffer_size * sizeof(int));
+        val_buffer[b] = has_vals ? (double *) malloc((size_t) buffer_size * sizeof(double)) : NULL;
+        if (!col_buffer[b] || (has_vals && !val_buffer[b])) {
+            ok = false;
+        }
+    }
+    if (!ok) {
+        fprintf(stderr, "Failed to allocate memory for the streaming buffers (%ld non-zeros each)\n", (long) buffer_size);
+        fflush(stderr);
+    }
+
+    /* Double buffered loop: read block b+1 while computing block b */
+    for (int i = 0; i < M; i++) {
+        result[i] = 0.0;
+    }
+    *wait_time = 0.0;
+    *bytes_read = (long) (M + 1) * sizeof(nz_t);
+    MPI_Request requests[2][2];
+    int start[2] = {0, 0}, end[2] = {0, 0};
+    int b = 0; // Buffer of the block being computed
+    if (ok) {
+        end[0] = block_end(M, row_ptr, 0, capacity);
+        read_block(file, col_idx_start, vals_start, row_ptr[0], (int) (row_ptr[end[0]] - row_ptr[0]), col_buffer[0], val_buffer[0], requests[0]);
+    }
+    while (ok) {
+        int count = (int) (row_ptr[end[b]] - row_ptr[start[b]]);
+        double t_start = MPI_Wtime();
+        if (!wait_block(requests[b], count, has_vals)) {
+            fprintf(stderr, "Failed to read rows %d-%d of the CSR cache: %s\n", start[b], end[b], cache_name);
+            fflush(stderr);
+            ok = false;
+            break;
+        }
+        *wait_time += MPI_Wtime() - t_start;
+
+        int next = 1 - b;
+        if (end[b] < M) {
+            start[next] = end[b];
+            end[next] = block_end(M, row_ptr, start[next], capacity);
+            read_block(file, col_idx_start, vals_start, row_ptr[start[next]], (int) (row_ptr[end[next]] - row_ptr[start[next]]),
+                       col_buffer[next], val_buffer[next], requests[next]);
+        }
+        block_product(start[b], end[b], row_ptr, col_buffer[b], val_buffer[b], symmetric, vector, result);
+        *bytes_read += (long) count * entry_bytes;
+        if (end[b] == M) {
+            break;
+        }
+        b = next;
+    }
+
+    MPI_File_close(&file);
+    free(row_ptr);
+    for (int i = 0; i < 2; i++) {
+        free(col_buffer[i]);
+        free(val_buffer[i]);
+    }
+    return ok;
+}
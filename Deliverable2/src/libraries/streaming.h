@@ -0,0 +1,11 @@
+#ifndef STREAMING_H
+#define STREAMING_H
+
+#include <stdbool.h>
+#include "index_types.h"
+
+#define STREAM_CHUNK_MB 64 // Default size of a block of col_idx and vals read at once
+
+bool SpMV_csr_stream(char *cache_name, int M, bool symmetric, long chunk_bytes, double *vector, double *result, double *wait_time, long *bytes_read);
+
+#endif
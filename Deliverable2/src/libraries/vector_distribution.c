@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <mpi.h>
+#include "vector_distribution.h"
+
+/*
+ * Distribution of the whole vector from rank 0 to every process of MPI_COMM_WORLD.
+ * Called by all the processes, rank 0 has the vector, the others receive it in "vector".
+ *   send:     rank 0 sends it to each process in turn, the time grows linearly with them
+ *   bcast:    the MPI library broadcast, a tree for short vectors
+ *   scatter:  each process gets a piece, then all of them gather all the pieces
+ *             (bandwidth-optimal for long vectors, each piece leaves rank 0 once)
+ *   pipeline: the vector is split in chunks forwarded along the chain 0 -> 1 -> ... -> size-1,
+ *             so all the links are busy at the same time after the first chunks
+ */
+
+static const char *method_names[VECTOR_METHODS] = {"send", "bcast", "scatter", "pipeline"};
+
+bool parse_vector_distribution(char *name, int *method) {
+    for (int m = 0; m < VECTOR_METHODS; m++) {
+        if (strcmp(name, method_names[m]) == 0) {
+            *method = m;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *vector_distribution_name(int method) {
+    return (method >= 0 && method < VECTOR_METHODS) ? method_names[method] : "unknown";
+}
+
+static bool scatter_allgather(double *vector, int count, int rank, int size) {
+    int *counts = (int *) malloc(size * sizeof(int));
+    int *displs = (int *) malloc(size * sizeof(int));
+    if (!counts || !displs) {
+        fprintf(stderr, "Process %d failed to allocate memory to distribute the vector\n", rank);
+        fflush(stderr);
+        free(counts);
+        free(displs);
+        return false;
+    }
+    for (int p = 0, offset = 0; p < size; p++) { // Same split as the rows distribution
+        counts[p] = count / size + (p < count % size ? 1 : 0);
+        displs[p] = offset;
+        offset += counts[p];
+    }
+
+    if (rank == 0) {
+        MPI_Scatterv(vector, counts, displs, MPI_DOUBLE, MPI_IN_PLACE, counts[0], MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    } else {
+        MPI_Scatterv(NULL, counts, displs, MPI_DOUBLE, &vector[displs[rank]], counts[rank], MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    }
+    MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, vector, counts, displs, MPI_DOUBLE, MPI_COMM_WORLD);
+
+    free(counts);
+    free(displs);
+    return true;
+}
+
+static bool pipeline(double *vector, int count, int chunk, int rank, int size) {
+    int chunks = (count + chunk - 1) / chunk;
+    MPI_Request *requests = (MPI_Request *) malloc((chunks > 0 ? chunks : 1) * sizeof(MPI_Request));
+    if (!requests) {
+        fprintf(stderr, "Process %d failed to allocate memory to distribute the vector\n", rank);
+        fflush(stderr);
+        return false;
+    }
+
+    int n_requests = 0;
+    for (int offset = 0; offset < count; offset += chunk) {
+        int n = (count - offset < chunk) ? count - offset : chunk;
+        if (rank > 0) {
+            MPI_Recv(&vector[offset], n, MPI_DOUBLE, rank - 1, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        }
+        if (rank < size - 1) { // Forward it while receiving the next chunk
+            MPI_Isend(&vector[offset], n, MPI_DOUBLE, rank + 1, 0, MPI_COMM_WORLD, &requests[n_requests++]);
+        }
+    }
+    MPI_Waitall(n_requests, requests, MPI_STATUSES_IGNORE);
+
+    free(requests);
+    return true;
+}
+
+bool distribute_vector(int method, double *vector, int count, int chunk) {
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    switch (method) {
+        case VECTOR_SEND:
+            if (rank == 0) {
+                for (int p = 1; p < size; p++) {
+                    MPI_Send(vector, count, MPI_DOUBLE, p, 0, MPI_COMM_WORLD);
+                }
+            } else {
+                MPI_Recv(vector, count, MPI_DOUBLE, 0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            }
+            return true;
+        case VECTOR_BCAST:
+            MPI_Bcast(vector, count, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+            return true;
+        case VECTOR_SCATTER:
+            return scatter_allgather(vector, count, rank, size);
+        case VECTOR_PIPELINE:
+            return pipeline(vector, count, chunk > 0 ? chunk : VECTOR_CHUNK, rank, size);
+        default:
+            fprintf(stderr, "Unknown vector distribution method: %d\n", method);
+            fflush(stderr);
+            return false;
+    }
+}
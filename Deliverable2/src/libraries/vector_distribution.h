@@ -0,0 +1,17 @@
+#ifndef VECTOR_DISTRIBUTION_H
+#define VECTOR_DISTRIBUTION_H
+
+#include <stdbool.h>
+
+#define VECTOR_SEND 0 // Serial point-to-point sends from rank 0
+#define VECTOR_BCAST 1 // MPI_Bcast
+#define VECTOR_SCATTER 2 // MPI_Scatterv of the pieces, then MPI_Allgatherv
+#define VECTOR_PIPELINE 3 // Chunks forwarded along the chain of ranks
+#define VECTOR_METHODS 4
+#define VECTOR_CHUNK 32768 // Doubles per pipeline chunk (256 KB)
+
+bool parse_vector_distribution(char *name, int *method);
+const char *vector_distribution_name(int method);
+bool distribute_vector(int method, double *vector, int count, int chunk);
+
+#endif